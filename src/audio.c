@@ -0,0 +1,817 @@
+/**
+ * Copyright (C) 2025 Craig Thomas
+ * This project uses an MIT style license - see the LICENSE file for details.
+ *
+ * @file      audio.c
+ * @brief     Routines for synthesizing the XO Chip audio pattern
+ * @author    Craig Thomas
+ *
+ * Sound is generated on the fly by an SDL audio callback. The callback walks
+ * through the 128 bits of the audio pattern with a phase accumulator: the top
+ * 7 bits of the 32-bit phase select the bit being played, and the phase
+ * advances by a step that depends on the playback rate set by the pitch
+ * register. Since the phase wraps around at the end of the pattern on its
+ * own, the pattern plays seamlessly for as long as the sound timer is set.
+ *
+ * The pattern is never resampled. The callback reads the bits straight out of
+ * the pattern (kept as two 64-bit words), and the playback rate and phase step
+ * for each of the 256 pitches are worked out once, so loading a new pattern or
+ * pitch only costs a copy and a table lookup. ROMs that play music by
+ * switching patterns every frame pay nothing more.
+ *
+ * The CPU thread never touches the mixer state directly. Pattern loads, pitch
+ * changes and sound timer changes are pushed as events into a single
+ * producer, single consumer ring buffer, each stamped with the guest time at
+ * which it happened: one frame's worth of samples per frame, plus a share of
+ * that for the instructions already run in the frame. The audio callback
+ * keeps its own guest clock, running one callback buffer and one frame behind
+ * the CPU, and applies each event at the sample that matches its time stamp.
+ * The length of a beep is then exact, no matter when the host schedules the
+ * CPU or audio threads. If the two clocks drift more than
+ * AUDIO_MAX_DRIFT_FRAMES apart (for example, while the emulator is paused),
+ * the callback clock jumps to catch up.
+ *
+ * The sample rate and the callback buffer size can be changed before audio
+ * starts. Smaller buffers lower the latency, but make underruns more likely
+ * on a busy host, so the callback keeps statistics on both: the time from a
+ * sound timer write on the CPU thread to its first sample reaching the
+ * device, and the number of callbacks that arrived too late to keep the
+ * device fed.
+ *
+ * Before the audio device is opened there is no callback to consume the
+ * events, so they are applied to the mixer state straight away.
+ *
+ * For headless runs, the audio can be rendered to a WAV file instead of a
+ * device. The CPU thread then consumes the queue itself, rendering exactly
+ * one frame of samples at the end of every guest frame, with the mixer
+ * clock locked to the guest clock. The output depends only on the events, so
+ * identical runs produce identical files, and a hash of every frame of audio
+ * is kept for comparing runs.
+ */
+
+/* I N C L U D E S ************************************************************/
+
+#include <math.h>
+#include "globals.h"
+
+/* D E F I N E S **************************************************************/
+
+#define AUDIO_PHASE_SHIFT  25    /**< Shift from the phase to the pattern bit */
+#define AUDIO_WAV_HEADER   44    /**< Size of a PCM WAV header                */
+#define AUDIO_HASH_SEED    0xCBF29CE484222325ULL /**< FNV-1a offset basis     */
+#define AUDIO_HASH_PRIME   0x100000001B3ULL      /**< FNV-1a prime            */
+
+/* L O C A L S ****************************************************************/
+
+/*!
+ * The sample rate, and the number of samples in each callback buffer
+ */
+static int audio_rate = AUDIO_PLAYBACK_RATE;
+static int audio_buffer_samples = AUDIO_SAMPLES;
+
+/*!
+ * The audio device, or 0 if audio is not open
+ */
+static SDL_AudioDeviceID audio_device;
+
+/*!
+ * The ring buffer of pending audio events
+ */
+static chip8audioevent audio_queue[AUDIO_QUEUE_SIZE];
+
+/*!
+ * The next slot to read from, only advanced by the consumer
+ */
+static SDL_atomic_t audio_head;
+
+/*!
+ * The next slot to write to, only advanced by the producer
+ */
+static SDL_atomic_t audio_tail;
+
+/*!
+ * Whether events go through the queue (TRUE) or are applied immediately
+ */
+static int audio_queued;
+
+/*!
+ * Whether sound changes made by the CPU are held back from the mixer
+ */
+static int audio_held;
+
+/*!
+ * The guest frame number and the sound timer state, as seen by the producer
+ */
+static Uint32 audio_guest_frame;
+static int audio_guest_gate;
+
+/*!
+ * The playback rate of every pitch, the phase step of every pitch at the
+ * current sample rate, and the sample rate the steps were worked out for
+ */
+static float audio_pitch_rates[256];
+static Uint32 audio_pitch_steps[256];
+static int audio_pitch_steps_rate;
+
+/*!
+ * The mixer state, only touched by the consumer: the pattern being played
+ * (bit 0 of the pattern is the top bit of the first word), the position in
+ * the pattern, how far it moves per output sample, and whether the sound
+ * timer is running
+ */
+static Uint64 audio_pattern[2];
+static Uint32 audio_phase;
+static Uint32 audio_step;
+static int audio_gate;
+
+/*!
+ * The guest time of the next sample the callback generates, and whether it
+ * needs to be lined up with the next event
+ */
+static Uint64 audio_time;
+static int audio_resync;
+
+/*!
+ * The number of events dropped because the queue was full
+ */
+static SDL_atomic_t audio_dropped;
+
+/*!
+ * Whether the mixer clock is locked to the guest clock (no resyncing)
+ */
+static int audio_lockstep;
+
+/*!
+ * The WAV file being rendered to, or NULL, and the samples written so far
+ */
+static FILE *audio_wav_file;
+static Uint32 audio_wav_samples;
+
+/*!
+ * The samples of the last rendered frame, and their hash
+ */
+static Uint8 audio_frame_buffer[AUDIO_MAX_RATE / SCREEN_VERTREFRESH + 1];
+static Uint64 audio_last_frame_hash;
+
+/*!
+ * Latency statistics (in performance counter ticks) for sound timer writes,
+ * and the callback timing statistics, only touched by the audio callback
+ */
+static Uint32 audio_latency_count;
+static Uint64 audio_latency_total;
+static Uint64 audio_latency_min;
+static Uint64 audio_latency_max;
+static Uint32 audio_callbacks;
+static Uint32 audio_underruns;
+static Uint32 audio_late_events;
+static Uint64 audio_callback_time;
+
+/* F U N C T I O N S **********************************************************/
+
+/**
+ * Returns the number of samples in a guest frame at the current sample rate.
+ *
+ * @returns the number of samples in a frame (rounded down)
+ */
+int
+audio_frame_samples(void)
+{
+    return audio_rate / SCREEN_VERTREFRESH;
+}
+
+/******************************************************************************/
+
+/**
+ * Returns how far the mixer clock runs behind the guest clock: one callback
+ * buffer, so that events are queued before their samples are generated, and
+ * one frame, to absorb scheduling jitter on the CPU thread.
+ *
+ * @returns the latency in samples
+ */
+int
+audio_latency(void)
+{
+    return audio_buffer_samples + audio_frame_samples();
+}
+
+/******************************************************************************/
+
+/**
+ * Returns the guest time at which a frame starts. Frames are not always a
+ * whole number of samples long, so the start is rounded down.
+ *
+ * @param frame the frame number
+ * @returns the time the frame starts, in samples
+ */
+static Uint64
+audio_frame_start(Uint32 frame)
+{
+    return (Uint64) frame * audio_rate / SCREEN_VERTREFRESH;
+}
+
+/******************************************************************************/
+
+/**
+ * Sets the sample rate and the callback buffer size. Must be called before
+ * audio starts. Returns FALSE if either is out of range, or the buffer size
+ * is not a power of two.
+ *
+ * @param rate the sample rate in Hz
+ * @param buffer_samples the number of samples in each callback buffer
+ * @returns TRUE if the format was set, FALSE otherwise
+ */
+int
+audio_set_format(int rate, int buffer_samples)
+{
+    if (rate < AUDIO_MIN_RATE || rate > AUDIO_MAX_RATE) {
+        return FALSE;
+    }
+    if (buffer_samples < AUDIO_MIN_SAMPLES || buffer_samples > AUDIO_MAX_SAMPLES ||
+            (buffer_samples & (buffer_samples - 1)) != 0) {
+        return FALSE;
+    }
+    audio_rate = rate;
+    audio_buffer_samples = buffer_samples;
+    return TRUE;
+}
+
+/******************************************************************************/
+
+/**
+ * Applies an audio event to the mixer state.
+ *
+ * @param audio_event the event to apply
+ */
+static void
+audio_apply(const chip8audioevent *audio_event)
+{
+    switch (audio_event->type) {
+        // A reset also loads the sound
+        case AUDIO_EVENT_RESET:
+            audio_phase = 0;
+            audio_gate = FALSE;
+            // Fall through
+
+        case AUDIO_EVENT_SOUND:
+            audio_pattern[0] = 0;
+            audio_pattern[1] = 0;
+            for (int x = 0; x < 16; x++) {
+                audio_pattern[x >> 3] = (audio_pattern[x >> 3] << 8) | audio_event->pattern[x];
+            }
+            audio_step = audio_event->step;
+            break;
+
+        case AUDIO_EVENT_GATE:
+            audio_gate = audio_event->gate;
+            break;
+
+        default:
+            break;
+    }
+}
+
+/******************************************************************************/
+
+/**
+ * Hands an event to the mixer, stamped with the current guest time. Must only
+ * be called from the CPU thread. Returns FALSE if the queue is full and the
+ * event was dropped.
+ *
+ * @param audio_event the event to send (the time is filled in)
+ * @returns TRUE if the event was sent, FALSE otherwise
+ */
+static int
+audio_push(chip8audioevent *audio_event)
+{
+    int frame_samples = audio_frame_samples();
+    int offset = (max_ticks > 0) ? tick_counter * frame_samples / max_ticks : 0;
+    if (offset >= frame_samples) {
+        offset = frame_samples - 1;
+    }
+    audio_event->time = audio_frame_start(audio_guest_frame) + offset;
+    audio_event->host_time = SDL_GetPerformanceCounter();
+
+    if (!audio_queued) {
+        audio_apply(audio_event);
+        return TRUE;
+    }
+
+    int tail = SDL_AtomicGet(&audio_tail);
+    if (tail - SDL_AtomicGet(&audio_head) >= AUDIO_QUEUE_SIZE) {
+        SDL_AtomicAdd(&audio_dropped, 1);
+        return FALSE;
+    }
+    audio_queue[tail & (AUDIO_QUEUE_SIZE - 1)] = *audio_event;
+    SDL_AtomicSet(&audio_tail, tail + 1);
+    return TRUE;
+}
+
+/******************************************************************************/
+
+/**
+ * Works out the playback rate of every pitch (4000 Hz at pitch 64, doubling
+ * every 48 pitches), if that has not been done yet, and the phase step of
+ * every pitch if the sample rate has changed.
+ */
+static void
+audio_build_pitch_tables(void)
+{
+    if (audio_pitch_steps_rate == audio_rate) {
+        return;
+    }
+    for (int x = 0; x < 256; x++) {
+        audio_pitch_rates[x] = 4000.0 * pow(2.0, (((float) x - 64.0) / 48.0));
+        audio_pitch_steps[x] = (Uint32) (audio_pitch_rates[x] / audio_rate * (1 << AUDIO_PHASE_SHIFT) + 0.5f);
+    }
+    audio_pitch_steps_rate = audio_rate;
+}
+
+/******************************************************************************/
+
+/**
+ * Returns the playback rate of a pitch.
+ *
+ * @param value the pitch (0 - 255)
+ * @returns the playback rate of the pattern in bits per second
+ */
+float
+audio_pitch_rate(int value)
+{
+    audio_build_pitch_tables();
+    return audio_pitch_rates[value & 0xFF];
+}
+
+/******************************************************************************/
+
+/**
+ * Fills in the pattern and the phase step of a sound event from the audio
+ * pattern buffer and the pitch.
+ *
+ * @param audio_event the event to fill in
+ */
+static void
+audio_fill_sound(chip8audioevent *audio_event)
+{
+    audio_build_pitch_tables();
+    memcpy(audio_event->pattern, audio_pattern_buffer, sizeof(audio_event->pattern));
+    audio_event->step = audio_pitch_steps[pitch & 0xFF];
+}
+
+/******************************************************************************/
+
+/**
+ * Records the latency of a sound timer write: the time from the write on the
+ * CPU thread to the callback that handles it, plus the time for the samples
+ * before it in this buffer, and the buffer already queued on the device, to
+ * play out.
+ *
+ * @param audio_event the event that opened the gate
+ * @param sample the sample of the buffer at which the gate opens
+ */
+static void
+audio_measure_latency(const chip8audioevent *audio_event, int sample)
+{
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    Uint64 latency = audio_callback_time - audio_event->host_time;
+    latency += (Uint64) (sample + audio_buffer_samples) * frequency / audio_rate;
+
+    if (audio_latency_count == 0 || latency < audio_latency_min) {
+        audio_latency_min = latency;
+    }
+    if (latency > audio_latency_max) {
+        audio_latency_max = latency;
+    }
+    audio_latency_total += latency;
+    audio_latency_count++;
+}
+
+/******************************************************************************/
+
+/**
+ * Fills an output buffer with the audio pattern, played at the playback
+ * rate. Any events that fall within the buffer are applied at their own
+ * sample. Output is silent while the sound timer is not running. Must only be
+ * called from the consumer (normally the audio callback).
+ *
+ * @param stream the buffer to fill with unsigned 8-bit samples
+ * @param length the number of samples to generate
+ */
+void
+audio_generate(Uint8 *stream, int length)
+{
+    Sint64 max_drift = (Sint64) AUDIO_MAX_DRIFT_FRAMES * audio_frame_samples();
+    int head = SDL_AtomicGet(&audio_head);
+    int n = 0;
+
+    while (n < length) {
+        // Apply the events that are due, and find out when the next one is
+        int run = length - n;
+        while (head != SDL_AtomicGet(&audio_tail)) {
+            const chip8audioevent *audio_event = &audio_queue[head & (AUDIO_QUEUE_SIZE - 1)];
+            Sint64 ahead = (Sint64) (audio_event->time - audio_time);
+            if (!audio_lockstep && (audio_resync || ahead > max_drift || ahead < -max_drift)) {
+                audio_time = audio_event->time - audio_latency();
+                audio_resync = FALSE;
+                ahead = audio_latency();
+            }
+            if (ahead > 0) {
+                if (ahead < run) {
+                    run = (int) ahead;
+                }
+                break;
+            }
+            if (ahead < 0 && !audio_lockstep) {
+                audio_late_events++;
+            }
+            if (audio_event->type == AUDIO_EVENT_GATE && audio_event->gate && audio_callback_time != 0) {
+                audio_measure_latency(audio_event, n);
+            }
+            audio_apply(audio_event);
+            head++;
+            SDL_AtomicSet(&audio_head, head);
+        }
+
+        if (audio_gate) {
+            Uint32 phase = audio_phase;
+            for (int x = n; x < n + run; x++) {
+                Uint32 bit = phase >> AUDIO_PHASE_SHIFT;
+                int on = (audio_pattern[bit >> 6] >> (63 - (bit & 63))) & 1;
+                stream[x] = on ? AUDIO_SILENCE + AUDIO_AMPLITUDE : AUDIO_SILENCE - AUDIO_AMPLITUDE;
+                phase += audio_step;
+            }
+            audio_phase = phase;
+        } else {
+            memset(&stream[n], AUDIO_SILENCE, run);
+        }
+        audio_time += run;
+        n += run;
+    }
+}
+
+/******************************************************************************/
+
+/**
+ * The SDL audio callback. Counts callbacks that arrive too late to keep the
+ * device fed, then fills the buffer. The first callback also sets up the
+ * audio thread for realtime mode.
+ *
+ * @param userdata unused
+ * @param stream the buffer to fill
+ * @param length the length of the buffer in bytes
+ */
+static void
+audio_callback(void *userdata, Uint8 *stream, int length)
+{
+    if (audio_callbacks == 0) {
+        realtime_enter_thread(REALTIME_AUDIO);
+    }
+    Uint64 now = SDL_GetPerformanceCounter();
+
+    // A callback more than half a buffer late means the device ran dry
+    if (audio_callback_time != 0) {
+        Uint64 period = (Uint64) audio_buffer_samples * SDL_GetPerformanceFrequency() / audio_rate;
+        if (now - audio_callback_time > period + period / 2) {
+            audio_underruns++;
+        }
+    }
+    audio_callback_time = now;
+    audio_callbacks++;
+    audio_generate(stream, length);
+}
+
+/******************************************************************************/
+
+/**
+ * Switches between applying events straight away and queueing them for the
+ * audio callback. Must only be called while nothing is consuming the queue.
+ *
+ * @param queued TRUE to queue events, FALSE to apply them immediately
+ */
+void
+audio_set_queued(int queued)
+{
+    SDL_AtomicSet(&audio_head, 0);
+    SDL_AtomicSet(&audio_tail, 0);
+    SDL_AtomicSet(&audio_dropped, 0);
+    audio_resync = TRUE;
+    audio_queued = queued;
+}
+
+/******************************************************************************/
+
+/**
+ * Holds back (or stops holding back) the sound changes made by the CPU. While
+ * held, audio_update, audio_set_gate and audio_reset do nothing. Used while
+ * running frames ahead that will be rolled back, so that they are never
+ * heard.
+ *
+ * @param held TRUE to hold back sound changes, FALSE to send them again
+ */
+void
+audio_hold(int held)
+{
+    audio_held = held;
+}
+
+/******************************************************************************/
+
+/**
+ * Sends the audio pattern buffer and the playback rate to the mixer. The new
+ * sound takes effect without restarting the phase.
+ */
+void
+audio_update(void)
+{
+    chip8audioevent audio_event;
+
+    if (audio_held) {
+        return;
+    }
+    audio_event.type = AUDIO_EVENT_SOUND;
+    audio_fill_sound(&audio_event);
+    audio_push(&audio_event);
+}
+
+/******************************************************************************/
+
+/**
+ * Opens or closes the output. The sound timer holds the gate open for as long
+ * as it is non-zero. Nothing is sent if the gate does not change.
+ *
+ * @param open TRUE if sound should be heard, FALSE otherwise
+ */
+void
+audio_set_gate(int open)
+{
+    chip8audioevent audio_event;
+
+    open = open ? TRUE : FALSE;
+    if (audio_held || open == audio_guest_gate) {
+        return;
+    }
+    audio_guest_gate = open;
+    audio_event.type = AUDIO_EVENT_GATE;
+    audio_event.gate = open;
+    audio_push(&audio_event);
+}
+
+/******************************************************************************/
+
+/**
+ * Renders the audio of the frame that just ended, adds it to the WAV file and
+ * hashes it.
+ */
+static void
+audio_render_frame(void)
+{
+    Uint64 hash = AUDIO_HASH_SEED;
+    int length = (int) (audio_frame_start(audio_guest_frame) - audio_time);
+
+    audio_generate(audio_frame_buffer, length);
+    for (int n = 0; n < length; n++) {
+        hash = (hash ^ audio_frame_buffer[n]) * AUDIO_HASH_PRIME;
+    }
+    audio_last_frame_hash = hash;
+
+    fwrite(audio_frame_buffer, 1, length, audio_wav_file);
+    audio_wav_samples += length;
+}
+
+/******************************************************************************/
+
+/**
+ * Moves the guest clock on to the next frame. Called by the CPU thread every
+ * time the timers are decremented. When rendering to a WAV file, the audio of
+ * the frame that just ended is rendered as well.
+ */
+void
+audio_advance_frame(void)
+{
+    audio_guest_frame++;
+    if (audio_wav_file != NULL) {
+        audio_render_frame();
+    }
+}
+
+/******************************************************************************/
+
+/**
+ * Returns the hash of the audio of the last frame rendered to the WAV file.
+ *
+ * @returns the 64-bit FNV-1a hash of the samples of the frame
+ */
+Uint64
+audio_frame_hash(void)
+{
+    return audio_last_frame_hash;
+}
+
+/******************************************************************************/
+
+/**
+ * Closes the gate, moves back to the start of the pattern, and loads the
+ * current audio pattern buffer and playback rate.
+ */
+void
+audio_reset(void)
+{
+    chip8audioevent audio_event;
+
+    if (audio_held) {
+        return;
+    }
+    audio_guest_gate = FALSE;
+    audio_event.type = AUDIO_EVENT_RESET;
+    audio_fill_sound(&audio_event);
+    audio_push(&audio_event);
+}
+
+/******************************************************************************/
+
+/**
+ * Returns the number of events dropped because the queue was full.
+ *
+ * @returns the number of dropped events
+ */
+int
+audio_dropped_events(void)
+{
+    return SDL_AtomicGet(&audio_dropped);
+}
+
+/******************************************************************************/
+
+/**
+ * Stores a 32-bit value in little endian order.
+ *
+ * @param buffer where to store the value
+ * @param value the value to store
+ */
+static void
+audio_put_le32(byte *buffer, Uint32 value)
+{
+    buffer[0] = value & 0xFF;
+    buffer[1] = (value >> 8) & 0xFF;
+    buffer[2] = (value >> 16) & 0xFF;
+    buffer[3] = (value >> 24) & 0xFF;
+}
+
+/******************************************************************************/
+
+/**
+ * Writes the header of an unsigned 8-bit mono PCM WAV file.
+ *
+ * @param fp the file to write to
+ * @param samples the number of samples in the file
+ */
+static void
+audio_wav_write_header(FILE *fp, Uint32 samples)
+{
+    byte header[AUDIO_WAV_HEADER] = {
+        'R', 'I', 'F', 'F', 0, 0, 0, 0, 'W', 'A', 'V', 'E',
+        'f', 'm', 't', ' ', 16, 0, 0, 0,
+        1, 0,   // PCM
+        1, 0,   // Mono
+        0, 0, 0, 0, 0, 0, 0, 0,
+        1, 0,   // Bytes per sample frame
+        8, 0,   // Bits per sample
+        'd', 'a', 't', 'a', 0, 0, 0, 0
+    };
+    audio_put_le32(&header[4], AUDIO_WAV_HEADER - 8 + samples);
+    audio_put_le32(&header[24], audio_rate);
+    audio_put_le32(&header[28], audio_rate);
+    audio_put_le32(&header[40], samples);
+    fwrite(header, 1, sizeof(header), fp);
+}
+
+/******************************************************************************/
+
+/**
+ * Starts rendering audio to a WAV file, in lockstep with the guest frames,
+ * instead of playing it on an audio device. Returns FALSE if the file could
+ * not be created.
+ *
+ * @param filename the name of the WAV file to write
+ * @returns TRUE if the file was created, FALSE otherwise
+ */
+int
+audio_wav_init(const char *filename)
+{
+    audio_wav_file = fopen(filename, "wb");
+    if (audio_wav_file == NULL) {
+        printf("Error: could not create WAV file: %s\n", filename);
+        return FALSE;
+    }
+    audio_wav_write_header(audio_wav_file, 0);
+    audio_wav_samples = 0;
+    audio_last_frame_hash = 0;
+
+    audio_set_queued(TRUE);
+    audio_lockstep = TRUE;
+    audio_time = audio_frame_start(audio_guest_frame);
+    return TRUE;
+}
+
+/******************************************************************************/
+
+/**
+ * Finishes the WAV file, filling in the sizes in its header.
+ */
+void
+audio_wav_destroy(void)
+{
+    if (audio_wav_file == NULL) {
+        return;
+    }
+    fseek(audio_wav_file, 0, SEEK_SET);
+    audio_wav_write_header(audio_wav_file, audio_wav_samples);
+    fclose(audio_wav_file);
+    audio_wav_file = NULL;
+    audio_lockstep = FALSE;
+    audio_set_queued(FALSE);
+}
+
+/******************************************************************************/
+
+/**
+ * Opens the audio device and starts the audio callback. From then on, events
+ * are queued for the callback. Returns FALSE if the device could not be
+ * opened.
+ *
+ * @returns TRUE if audio was started, FALSE otherwise
+ */
+int
+audio_init(void)
+{
+    SDL_AudioSpec desired;
+    SDL_AudioSpec obtained;
+
+    memset(&desired, 0, sizeof(desired));
+    desired.freq = audio_rate;
+    desired.format = AUDIO_U8;
+    desired.channels = 1;
+    desired.samples = audio_buffer_samples;
+    desired.callback = audio_callback;
+
+    audio_device = SDL_OpenAudioDevice(NULL, 0, &desired, &obtained, 0);
+    if (audio_device == 0) {
+        printf("Error: could not open audio device\n%s\n", SDL_GetError());
+        return FALSE;
+    }
+
+    audio_set_queued(TRUE);
+    audio_callback_time = 0;
+    audio_callbacks = 0;
+    audio_underruns = 0;
+    audio_late_events = 0;
+    audio_latency_count = 0;
+    audio_latency_total = 0;
+    audio_latency_max = 0;
+    SDL_PauseAudioDevice(audio_device, 0);
+    return TRUE;
+}
+
+/******************************************************************************/
+
+/**
+ * Stops the audio callback and closes the audio device. Events are applied
+ * straight away again afterwards.
+ */
+void
+audio_destroy(void)
+{
+    if (audio_device == 0) {
+        return;
+    }
+    SDL_CloseAudioDevice(audio_device);
+    audio_device = 0;
+    audio_callback_time = 0;
+    audio_set_queued(FALSE);
+}
+
+/******************************************************************************/
+
+/**
+ * Prints the audio format, the callback statistics and the sound timer
+ * latency. Must only be called once the audio device has been closed.
+ */
+void
+audio_print_stats(void)
+{
+    double frequency = (double) SDL_GetPerformanceFrequency() / 1000.0;
+
+    printf("Audio: %d Hz, %d sample buffer, %u callbacks, %u underruns, %u late events, %d dropped events\n",
+           audio_rate, audio_buffer_samples, audio_callbacks, audio_underruns, audio_late_events,
+           audio_dropped_events());
+    if (audio_latency_count == 0) {
+        printf("Audio latency: no sound timer writes\n");
+        return;
+    }
+    printf("Audio latency: %u sound timer writes, min %.1f ms, avg %.1f ms, max %.1f ms\n",
+           audio_latency_count,
+           audio_latency_min / frequency,
+           audio_latency_total / frequency / audio_latency_count,
+           audio_latency_max / frequency);
+}
+
+/* E N D   O F   F I L E ******************************************************/
@@ -0,0 +1,172 @@
+/**
+ * Copyright (C) 2025 Craig Thomas
+ * This project uses an MIT style license - see the LICENSE file for details.
+ *
+ * @file      audio_test.c
+ * @brief     Tests for the audio synthesizer
+ * @author    Craig Thomas
+ */
+
+/* I N C L U D E S ************************************************************/
+
+#include <CUnit/CUnit.h>
+#include "globals.h"
+
+/* D E F I N E S **************************************************************/
+
+#define AUDIO_HIGH (AUDIO_SILENCE + AUDIO_AMPLITUDE)
+#define AUDIO_LOW  (AUDIO_SILENCE - AUDIO_AMPLITUDE)
+
+/* F U N C T I O N S **********************************************************/
+
+void
+test_audio_generate_silent_when_gated(void)
+{
+    Uint8 stream[AUDIO_SAMPLES];
+
+    cpu_reset();
+    memset(audio_pattern_buffer, 0xFF, sizeof(audio_pattern_buffer));
+    audio_update();
+    audio_generate(stream, AUDIO_SAMPLES);
+    for (int n = 0; n < AUDIO_SAMPLES; n++) {
+        CU_ASSERT_EQUAL(AUDIO_SILENCE, stream[n]);
+    }
+    cpu_reset();
+}
+
+void
+test_audio_generate_plays_pattern(void)
+{
+    Uint8 stream[2000];
+
+    // At the default 4000 Hz, each bit of the pattern lasts 12 samples
+    cpu_reset();
+    audio_pattern_buffer[0] = 0x80;
+    audio_update();
+    audio_set_gate(TRUE);
+    audio_generate(stream, 1000);
+    audio_generate(&stream[1000], 1000);
+    CU_ASSERT_EQUAL(AUDIO_HIGH, stream[0]);
+    CU_ASSERT_EQUAL(AUDIO_HIGH, stream[10]);
+    CU_ASSERT_EQUAL(AUDIO_LOW, stream[13]);
+    CU_ASSERT_EQUAL(AUDIO_LOW, stream[999]);
+    CU_ASSERT_EQUAL(AUDIO_LOW, stream[1530]);
+    CU_ASSERT_EQUAL(AUDIO_HIGH, stream[1537]);
+    CU_ASSERT_EQUAL(AUDIO_LOW, stream[1550]);
+    cpu_reset();
+}
+
+void
+test_audio_load_pitch_changes_rate(void)
+{
+    Uint8 stream[16];
+
+    // At 8000 Hz, each bit of the pattern lasts 6 samples
+    cpu_reset();
+    audio_pattern_buffer[0] = 0x80;
+    cpu.v[1] = 112;
+    cpu.operand.WORD = 0xF13A;
+    load_pitch();
+    audio_set_gate(TRUE);
+    audio_generate(stream, 16);
+    CU_ASSERT_EQUAL(AUDIO_HIGH, stream[4]);
+    CU_ASSERT_EQUAL(AUDIO_LOW, stream[7]);
+    cpu_reset();
+}
+
+void
+test_audio_queue_applies_events_on_time(void)
+{
+    int frame = audio_frame_samples();
+    Uint8 stream[audio_latency() + 3 * frame];
+    int start = audio_latency() + frame / 2;
+    int end = audio_latency() + 2 * frame;
+    int saved_max_ticks = max_ticks;
+
+    // The sound starts half way through a frame and stops two frames later
+    audio_set_queued(TRUE);
+    max_ticks = 10;
+    cpu_reset();
+    memset(audio_pattern_buffer, 0xFF, sizeof(audio_pattern_buffer));
+    audio_update();
+    tick_counter = 5;
+    audio_set_gate(TRUE);
+    tick_counter = 0;
+    audio_advance_frame();
+    audio_advance_frame();
+    audio_set_gate(FALSE);
+
+    // The mixer runs audio_latency() samples behind, whatever the buffer size
+    audio_generate(stream, 100);
+    audio_generate(&stream[100], 1);
+    audio_generate(&stream[101], sizeof(stream) - 101);
+    CU_ASSERT_EQUAL(AUDIO_SILENCE, stream[0]);
+    CU_ASSERT_EQUAL(AUDIO_SILENCE, stream[start - 1]);
+    CU_ASSERT_EQUAL(AUDIO_HIGH, stream[start]);
+    CU_ASSERT_EQUAL(AUDIO_HIGH, stream[end - 1]);
+    CU_ASSERT_EQUAL(AUDIO_SILENCE, stream[end]);
+    CU_ASSERT_EQUAL(0, audio_dropped_events());
+
+    audio_set_queued(FALSE);
+    max_ticks = saved_max_ticks;
+    cpu_reset();
+}
+
+void
+test_audio_wav_render(void)
+{
+    int frame = audio_frame_samples();
+    Uint64 hashes[2][2];
+    byte contents[44 + 2 * frame + 1];
+
+    // Render a frame of sound followed by a frame of silence, twice
+    for (int run = 0; run < 2; run++) {
+        cpu_reset();
+        CU_TEST_FATAL(audio_wav_init("test_audio.wav"));
+        memset(audio_pattern_buffer, 0xFF, sizeof(audio_pattern_buffer));
+        audio_update();
+        audio_set_gate(TRUE);
+        audio_advance_frame();
+        hashes[run][0] = audio_frame_hash();
+        audio_set_gate(FALSE);
+        audio_advance_frame();
+        hashes[run][1] = audio_frame_hash();
+        audio_wav_destroy();
+    }
+    CU_ASSERT_EQUAL(hashes[0][0], hashes[1][0]);
+    CU_ASSERT_EQUAL(hashes[0][1], hashes[1][1]);
+    CU_ASSERT_NOT_EQUAL(hashes[0][0], hashes[0][1]);
+
+    FILE *fp = fopen("test_audio.wav", "rb");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(fp);
+    size_t length = fread(contents, 1, sizeof(contents), fp);
+    fclose(fp);
+    remove("test_audio.wav");
+
+    CU_ASSERT_EQUAL(44 + 2 * frame, length);
+    CU_ASSERT_EQUAL(0, memcmp(contents, "RIFF", 4));
+    CU_ASSERT_EQUAL(0, memcmp(&contents[36], "data", 4));
+    CU_ASSERT_EQUAL(2 * frame, contents[40] | (contents[41] << 8));
+    CU_ASSERT_EQUAL(AUDIO_HIGH, contents[44]);
+    CU_ASSERT_EQUAL(AUDIO_HIGH, contents[44 + frame - 1]);
+    CU_ASSERT_EQUAL(AUDIO_SILENCE, contents[44 + frame]);
+    cpu_reset();
+}
+
+void
+test_audio_set_format(void)
+{
+    CU_ASSERT_FALSE(audio_set_format(AUDIO_MIN_RATE - 1, AUDIO_SAMPLES));
+    CU_ASSERT_FALSE(audio_set_format(AUDIO_PLAYBACK_RATE, 500));
+    CU_ASSERT_FALSE(audio_set_format(AUDIO_PLAYBACK_RATE, AUDIO_MAX_SAMPLES * 2));
+
+    // At 44.1 kHz, each frame is 735 samples long and the latency follows
+    CU_ASSERT_TRUE(audio_set_format(44100, 256));
+    CU_ASSERT_EQUAL(735, audio_frame_samples());
+    CU_ASSERT_EQUAL(256 + 735, audio_latency());
+
+    CU_ASSERT_TRUE(audio_set_format(AUDIO_PLAYBACK_RATE, AUDIO_SAMPLES));
+    CU_ASSERT_EQUAL(800, audio_frame_samples());
+}
+
+/* E N D   O F   F I L E ******************************************************/
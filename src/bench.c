@@ -0,0 +1,203 @@
+/**
+ * Copyright (C) 2025 Craig Thomas
+ * This project uses an MIT style license - see the LICENSE file for details.
+ *
+ * @file      bench.c
+ * @brief     Benchmarks for the emulator
+ * @author    Craig Thomas
+ *
+ * Runs a set of micro-benchmarks against the hot paths of the emulator and
+ * prints the results. None of the benchmarks require a window or an audio
+ * device.
+ */
+
+/* I N C L U D E S ************************************************************/
+
+#include <math.h>
+#include <stdlib.h>
+#include "globals.h"
+
+/* F U N C T I O N S **********************************************************/
+
+/**
+ * Returns the current time in seconds from the high resolution counter.
+ *
+ * @returns the current time in seconds
+ */
+double
+bench_now(void)
+{
+    return (double) SDL_GetPerformanceCounter() / (double) SDL_GetPerformanceFrequency();
+}
+
+/******************************************************************************/
+
+/**
+ * Times every supported pixel expansion kernel at each scale factor that the
+ * emulator accepts, and reports how each one compares to the scalar kernel.
+ */
+void
+bench_expand(void)
+{
+    chip8display source;
+    Uint32 palette[4] = { 0x00000000, 0xFFFA33CC, 0x0033CCFA, 0x00FAFAFA };
+
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        for (int x = 0; x < SCREEN_ROW_BYTES; x++) {
+            source.plane[0][y][x] = (byte) rand();
+            source.plane[1][y][x] = (byte) rand();
+        }
+    }
+
+    printf("Bitplane expansion (frames per second)\n");
+    printf("  scale  %10s  %10s  %10s\n", "scalar", "sse2", "avx2");
+    for (int scale = 1; scale <= 20; scale++) {
+        int width = SCREEN_WIDTH * scale;
+        Uint32 *pixels = malloc(width * SCREEN_HEIGHT * scale * sizeof(Uint32));
+        int iterations = 1 + (20000 / (scale * scale));
+        double scalar_rate = 0.0;
+
+        printf("  %5d", scale);
+        for (int kernel = EXPAND_SCALAR; kernel <= EXPAND_AVX2; kernel++) {
+            if (!expand_is_supported(kernel)) {
+                printf("  %10s", "n/a");
+                continue;
+            }
+            double start = bench_now();
+            for (int i = 0; i < iterations; i++) {
+                expand_bitplanes_with(kernel, &source, pixels, width * sizeof(Uint32), palette, scale, scale);
+            }
+            double rate = iterations / (bench_now() - start);
+            if (kernel == EXPAND_SCALAR) {
+                scalar_rate = rate;
+                printf("  %10.0f", rate);
+            } else {
+                printf("  %10.0f (%.1fx)", rate, rate / scalar_rate);
+            }
+        }
+        printf("\n");
+        free(pixels);
+    }
+    printf("\n");
+}
+
+/******************************************************************************/
+
+/**
+ * Compares hashing the whole display every frame against the incremental
+ * screen_hash, where only the row touched by a single pixel is rehashed.
+ */
+void
+bench_hash(void)
+{
+    int iterations = 200000;
+    volatile Uint64 hash = 0;
+
+    screen_init();
+    screen_set_extended_mode();
+
+    double start = bench_now();
+    for (int i = 0; i < iterations; i++) {
+        draw_pixel(i & 127, i & 63, i & 1, 1);
+        hash ^= screen_hash_display(&display, screen_mode);
+    }
+    double full_rate = iterations / (bench_now() - start);
+
+    start = bench_now();
+    for (int i = 0; i < iterations; i++) {
+        draw_pixel(i & 127, i & 63, i & 1, 1);
+        hash ^= screen_hash();
+    }
+    double incremental_rate = iterations / (bench_now() - start);
+
+    printf("Screen hash (frames per second)\n");
+    printf("  full         %10.0f\n", full_rate);
+    printf("  incremental  %10.0f (%.1fx)\n\n", incremental_rate, incremental_rate / full_rate);
+    screen_destroy();
+}
+
+/******************************************************************************/
+
+/**
+ * Switches the audio pattern and pitch the way the emulator used to: working
+ * out the playback rate with pow, expanding the pattern to one sample per
+ * bit, resampling it at the playback rate, and repeating it to fill a
+ * buffer. Used as the baseline for bench_audio.
+ *
+ * @param pattern the 16-byte audio pattern
+ * @param value the pitch
+ * @param buffer where to store the resampled sound
+ * @returns the number of samples in the buffer
+ */
+static int
+bench_audio_resample(const byte *pattern, int value, Uint8 *buffer)
+{
+    int expanded[128];
+    Uint8 resampled[10000];
+    int length = 0;
+
+    float rate = 4000.0 * pow(2.0, (((float) value - 64.0) / 48.0));
+    for (int x = 0; x < 128; x++) {
+        expanded[x] = (pattern[x >> 3] >> (7 - (x & 7))) & 1 ? 127 : 0;
+    }
+    float step = rate / AUDIO_PLAYBACK_RATE;
+    for (float position = 0.0f; position < 128.0f; position += step) {
+        resampled[length++] = expanded[(int) position];
+    }
+    int copies = 3200 / length;
+    for (int x = 0; x < copies; x++) {
+        memcpy(&buffer[x * length], resampled, length);
+    }
+    return copies * length;
+}
+
+/******************************************************************************/
+
+/**
+ * Compares how many times per second the audio pattern and pitch can be
+ * switched, by resampling (as the emulator used to) and with the pitch
+ * tables and the phase accumulator.
+ */
+void
+bench_audio(void)
+{
+    int iterations = 100000;
+    Uint8 buffer[3200];
+    volatile int total = 0;
+
+    cpu_reset();
+    double start = bench_now();
+    for (int i = 0; i < iterations; i++) {
+        audio_pattern_buffer[i & 15] = (byte) i;
+        total += bench_audio_resample(audio_pattern_buffer, i & 0xFF, buffer);
+    }
+    double resample_rate = iterations / (bench_now() - start);
+
+    start = bench_now();
+    for (int i = 0; i < iterations; i++) {
+        audio_pattern_buffer[i & 15] = (byte) i;
+        pitch = i & 0xFF;
+        playback_rate = audio_pitch_rate(pitch);
+        audio_update();
+    }
+    double table_rate = iterations / (bench_now() - start);
+
+    printf("Audio pattern and pitch switches (per second)\n");
+    printf("  resample     %10.0f\n", resample_rate);
+    printf("  table        %10.0f (%.1fx)\n\n", table_rate, table_rate / resample_rate);
+    cpu_reset();
+}
+
+/* M A I N ********************************************************************/
+
+int
+main(int argc, char **argv)
+{
+    printf("Pixel expansion kernel selected: %s\n\n", expand_kernel_name(expand_init()));
+    bench_expand();
+    bench_hash();
+    bench_audio();
+    return 0;
+}
+
+/* E N D   O F   F I L E ******************************************************/
@@ -9,45 +9,183 @@
 
 /* I N C L U D E S ************************************************************/
 
-#include <math.h>
 #include <time.h>
 #include "globals.h"
 
+/* L O C A L S ****************************************************************/
+
+/*!
+ * The number of ticks that have fired but have not started a frame yet
+ */
+static SDL_atomic_t cpu_pending_ticks;
+
+/*!
+ * The number of ticks skipped, either because the CPU had too many frames to
+ * catch up on, or because the timer itself stalled
+ */
+static SDL_atomic_t cpu_skipped_ticks;
+
+/*!
+ * The state to roll back to after running ahead. Its memory only differs
+ * from emulator memory in the pages marked in `memory_dirty`.
+ */
+static chip8snapshot cpu_snapshot;
+
+/*!
+ * The number of frames that ran ahead, and the total and worst time taken
+ * (in performance counter ticks)
+ */
+static Uint32 cpu_run_ahead_count;
+static Uint64 cpu_run_ahead_total;
+static Uint64 cpu_run_ahead_worst;
+
+/*!
+ * The total number of memory pages copied to take and roll back checkpoints
+ */
+static Uint64 cpu_run_ahead_pages;
+
+/*!
+ * Set once the CPU execution loop has finished. `cpu.state` belongs to the
+ * CPU thread (and is rolled back with the rest of the machine when running
+ * ahead), so this is what the other threads watch for a stop.
+ */
+static SDL_atomic_t cpu_stop_flag;
+
 /* F U N C T I O N S **********************************************************/
 
 /**
- * This function runs a set of routines based on the SDL timer that is set in
- * `cpu_timerinit`. In this case, the timer will decrement the sound and delay
- * timer registers.
- * 
- * @param interval the number of milliseconds to fire on
- * @param parameters additional parameters to the interrupt routine
- * @returns the new interval at which to fire the timer
+ * This function is called by the timer thread on every tick. It lets the CPU
+ * start its next frame, which is when the sound and delay timers are
+ * decremented. If the CPU is already CPU_MAX_CATCHUP_FRAMES frames behind,
+ * the tick is skipped rather than making the CPU catch up on it later.
  */
-Uint32 
-cpu_timerinterrupt(Uint32 interval, void *parameters)
+void
+cpu_timerinterrupt(void)
 {
-    decrement_timers = TRUE;
-    tick_counter = 0;
-    return interval;
+    if (SDL_AtomicGet(&cpu_pending_ticks) < CPU_MAX_CATCHUP_FRAMES) {
+        SDL_AtomicIncRef(&cpu_pending_ticks);
+    } else {
+        SDL_AtomicIncRef(&cpu_skipped_ticks);
+    }
+    SDL_SemPost(cpu_tick);
 }
 
 /******************************************************************************/
 
 /**
- * Initializes an SDL timer to tick at a rate of 60 times per second. Will call
- * `cpu_timerinterrupt` every time the timer counts down to zero.
+ * Returns the time at which a frame is due, counting from the time the first
+ * frame started. Each deadline is worked out from the start rather than from
+ * the previous deadline, so rounding never builds up and the long term rate
+ * is exactly SCREEN_VERTREFRESH frames per second.
  *
- * @returns the newly created SDL timer
+ * @param start the time the first frame started (in nanoseconds)
+ * @param frame the number of the frame
+ * @returns the time the frame is due (in nanoseconds)
+ */
+Uint64
+cpu_frame_deadline(Uint64 start, Uint64 frame)
+{
+    return start + frame * 1000000000ULL / SCREEN_VERTREFRESH;
+}
+
+/******************************************************************************/
+
+/**
+ * Returns the background policy in effect right now. This is the chosen
+ * policy while the window is hidden, minimized or unfocused, and
+ * BACKGROUND_RUN otherwise.
+ *
+ * @returns the policy in effect (one of the BACKGROUND_ defines)
+ */
+int
+cpu_background_mode(void)
+{
+    return video_in_background() ? background_policy : BACKGROUND_RUN;
+}
+
+/******************************************************************************/
+
+/**
+ * Returns the current time on the monotonic clock.
+ *
+ * @returns the current time (in nanoseconds)
+ */
+static Uint64
+cpu_now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (Uint64) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/******************************************************************************/
+
+/**
+ * The entry point for the timer thread. Sleeps until each frame deadline
+ * with `clock_nanosleep`, and then ticks. If the thread wakes up late, the
+ * ticks it missed fire straight away so the CPU can catch up, unless it is
+ * more than CPU_MAX_CATCHUP_FRAMES frames late. In that case the missed
+ * ticks are skipped, and deadlines are counted from the current time.
+ *
+ * @param data unused
+ * @returns always 0
+ */
+static int
+cpu_timer_thread(void *data)
+{
+    Uint64 start;
+    Uint64 frame = 0;
+
+    realtime_enter_thread(REALTIME_TIMER);
+    start = cpu_now();
+
+    while (!cpu_stopped()) {
+        Uint64 deadline = cpu_frame_deadline(start, ++frame);
+        struct timespec wakeup = { deadline / 1000000000ULL, deadline % 1000000000ULL };
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeup, NULL) != 0) {
+            // Interrupted by a signal, so go back to sleep
+        }
+
+        Uint64 now = cpu_now();
+        if (now - deadline > CPU_MAX_CATCHUP_FRAMES * 1000000000ULL / SCREEN_VERTREFRESH) {
+            SDL_AtomicAdd(&cpu_skipped_ticks, (now - start) * SCREEN_VERTREFRESH / 1000000000ULL - frame);
+            start = now;
+            frame = 0;
+        }
+
+        // In the background, pausing holds back every tick, and running
+        // slowly holds back all but one tick in BACKGROUND_SLOWDOWN
+        int mode = cpu_background_mode();
+        if (mode == BACKGROUND_PAUSE || (mode == BACKGROUND_SLOW && frame % BACKGROUND_SLOWDOWN != 0)) {
+            continue;
+        }
+        cpu_timerinterrupt();
+    }
+    return 0;
+}
+
+/******************************************************************************/
+
+/**
+ * Starts a thread that ticks 60 times per second, calling
+ * `cpu_timerinterrupt` on every tick. When running unthrottled, no timer is
+ * started, since the CPU ends its own frames.
+ *
+ * @returns TRUE on success, FALSE otherwise
  */
 int 
 cpu_timerinit(void)
 {
     int result = TRUE;
-    SDL_InitSubSystem(SDL_INIT_TIMER);
-    cpu_timer = SDL_AddTimer(17, cpu_timerinterrupt, NULL);
+    cpu_tick = SDL_CreateSemaphore(0);
+    SDL_AtomicSet(&cpu_pending_ticks, 0);
+    SDL_AtomicSet(&cpu_skipped_ticks, 0);
+    if (unthrottled) {
+        return result;
+    }
+    cpu_timer = SDL_CreateThread(cpu_timer_thread, "timer", NULL);
 
-    if (cpu_timer == 0) {
+    if (cpu_timer == NULL) {
         printf("Error: could not create timer: %s\n", SDL_GetError());
         result = FALSE;
     }
@@ -57,6 +195,47 @@ cpu_timerinit(void)
 
 /******************************************************************************/
 
+/**
+ * Waits for the timer thread to finish, once the CPU has stopped. Reports
+ * how many ticks were skipped because the emulator fell too far behind.
+ */
+void
+cpu_timerdestroy(void)
+{
+    if (cpu_timer != NULL) {
+        SDL_WaitThread(cpu_timer, NULL);
+        cpu_timer = NULL;
+    }
+    if (SDL_AtomicGet(&cpu_skipped_ticks) > 0) {
+        printf("Warning: %d frames were skipped to keep up\n", SDL_AtomicGet(&cpu_skipped_ticks));
+    }
+}
+
+/******************************************************************************/
+
+/**
+ * Returns TRUE if the CPU should start the next frame. When running
+ * unthrottled, this is as soon as the frame's instructions have run. Otherwise
+ * it is once the frame's instructions have run (or FX0A is waiting for a key)
+ * and a tick is pending, which uses up the tick.
+ *
+ * @returns TRUE if the next frame should start, FALSE otherwise
+ */
+static int
+cpu_frame_ready(void)
+{
+    if (unthrottled) {
+        return tick_counter >= max_ticks;
+    }
+    if ((tick_counter < max_ticks && !awaiting_keypress) || SDL_AtomicGet(&cpu_pending_ticks) == 0) {
+        return FALSE;
+    }
+    SDL_AtomicAdd(&cpu_pending_ticks, -1);
+    return TRUE;
+}
+
+/******************************************************************************/
+
 /**
  * Resets the CPU registers.
  */
@@ -108,8 +287,9 @@ cpu_reset(void)
     cpu.oldpc.WORD = CPU_PC_START;
     cpu.operand.WORD = 0;
  
-    srand(time(0));
+    cpu.random = (Uint32) time(0) | 1;
     cpu.state = CPU_PAUSED;
+    SDL_AtomicSet(&cpu_stop_flag, FALSE);
 
     if (cpu.opdesc != NULL) {
         free(cpu.opdesc);
@@ -125,59 +305,66 @@ cpu_reset(void)
     for (int x = 0; x < 16; x++) {
         audio_pattern_buffer[x] = 0;
     }
+    audio_reset();
 
-    // If audio is playing, stop it
-    if (audio_playing) {
-        Mix_HaltChannel(AUDIO_CHANNEL);
-    }
-    audio_playing = FALSE;
+    tick_counter = 0;
+}
 
-    // Delete the pre-calculated audio chunk
-    if (audio_chunk.alen != 0) {
-        free(audio_chunk.abuf);
-    }
-    audio_chunk.abuf = NULL;
-    audio_chunk.alen = 0;
+/******************************************************************************/
 
-    tick_counter = 0;
+/**
+ * Handles a press of an emulator key. If FX0A is waiting for a key, the key
+ * is stored in its register and execution resumes.
+ *
+ * @param emulatorkey the emulator key that was pressed, or -1 if none
+ */
+void
+cpu_keypress(int emulatorkey)
+{
+    if (awaiting_keypress && emulatorkey != -1) {
+        int x = cpu.operand.BYTE.high & 0xF;
+        cpu.v[x] = emulatorkey;
+        awaiting_keypress = FALSE;
+    }
 }
 
 /******************************************************************************/
 
 /**
- * Process any events inside the SDL event queue. Will not block waiting for
- * events. Any event not processed by the emulator will be discarded.
+ * Process all the input events that the main thread has queued for the CPU.
+ * Will not block waiting for events. This is the input phase of a frame, so
+ * it runs once per frame (plus every `poll_interval` instructions when set),
+ * rather than after every instruction.
  */
 void 
-cpu_process_sdl_events(void)
+cpu_process_input(void)
 {
-    int emulatorkey;
-    SDL_KeyCode key;
+    chip8input input;
 
-    if (SDL_PollEvent(&event)) {
-        switch (event.type) {
-            case SDL_QUIT:
+    while (input_pop(&input)) {
+        switch (input.type) {
+            case INPUT_QUIT:
                 cpu.state = CPU_STOP;
                 break;
 
-            case SDL_KEYDOWN:
-                key = event.key.keysym.sym;
-                if (key == QUIT_KEY) {
+            case INPUT_KEYDOWN:
+                latency_input(&input);
+                if (input.key == QUIT_KEY) {
                     cpu.state = CPU_STOP;
                 } 
-                keyboard_processkeydown(key);
-                if (awaiting_keypress) {
-                    emulatorkey = keyboard_isemulatorkey(key);
-                    if (emulatorkey != -1) {
-                        int x = cpu.operand.BYTE.high & 0xF;
-                        cpu.v[x] = emulatorkey;
-                        awaiting_keypress = FALSE;
-                    }
+                if (input.key == SCREENSHOT_KEY) {
+                    record_screenshot();
+                } 
+                if (input.key == LATENCY_KEY) {
+                    latency_request_print();
                 }
+                keyboard_processkeydown(input.key);
+                cpu_keypress(keyboard_isemulatorkey(input.key));
                 break;
 
-            case SDL_KEYUP:
-                keyboard_processkeyup(event.key.keysym.sym);
+            case INPUT_KEYUP:
+                latency_input(&input);
+                keyboard_processkeyup(input.key);
                 break;
 
             default:
@@ -1014,7 +1201,13 @@ void
 generate_random_number(void)
 {
     int x = cpu.operand.BYTE.high & 0xF;
-    cpu.v[x] = (rand() % 255) & cpu.operand.BYTE.low;
+
+    // A xorshift generator, kept with the registers so that restoring a
+    // snapshot (as run-ahead does) repeats the same numbers
+    cpu.random ^= cpu.random << 13;
+    cpu.random ^= cpu.random >> 17;
+    cpu.random ^= cpu.random << 5;
+    cpu.v[x] = (cpu.random % 255) & cpu.operand.BYTE.low;
     sprintf(cpu.opdesc, "RAND V%X, %02X", x, (cpu.operand.BYTE.low));
 }
 
@@ -1051,6 +1244,10 @@ generate_random_number(void)
  * the x and y coordinates for the sprite. If writing a pixel to  
  * a location causes that pixel to be turned off, then VF will be 
  * set to 1.                                                      
+ *
+ * With display wait quirks turned on, drawing a sprite ends the
+ * instructions for the current frame, as the original hardware
+ * waited for the vertical blank before drawing.
  */
 void
 draw_sprite(void)
@@ -1078,7 +1275,10 @@ draw_sprite(void)
         sprintf(cpu.opdesc, "DRAW V%X, V%X, %X", x, y, (cpu.operand.WORD & 0xF));
     }
 
-    screen_refresh();
+    // Drawing waits for the vertical blank, so nothing else runs this frame
+    if (display_wait_quirks) {
+        tick_counter = max_ticks;
+    }
 }
 
 /******************************************************************************/
@@ -1253,78 +1453,12 @@ load_audio_pattern_buffer(void)
     for (int x = 0; x < 16; x++) {
         audio_pattern_buffer[x] = memory_read(cpu.i.WORD + x);
     }
-    calculate_audio_waveform();
+    audio_update();
     sprintf(cpu.opdesc, "AUDIO %X", cpu.i.WORD);
 }
 
 /******************************************************************************/
 
-/**
- * Based on a playback rate specified by the XO Chip pitch, generate
- * an audio waveform from the 16-byte audio_pattern_buffer. It converts
- * the 16-bytes pattern into 128 separate bits. The bits are then used to fill
- * a sample buffer. The sample buffer is filled by resampling the 128-bit
- * pattern at the specified frequency. The sample buffer is then repeated
- * until it is at least MIN_AUDIO_SAMPLES long. Playback (if currently
- * happening) is stopped, the new waveform is loaded, and then playback
- * is starts again (if the emulator had previously been playing a sound).
- */
-void
-calculate_audio_waveform(void)
-{
-    int expanded_buffer[128];
-    int ptr = 0;
-
-    // Convert the 16-byte audio pattern into a 128-bit sample buffer
-    for (int x = 0; x < 16; x++) {
-        int buffer_mask = 0x80;
-        int audio_byte = audio_pattern_buffer[x];
-        for (int y = 0; y < 8; y++) {
-            expanded_buffer[ptr] = (audio_byte & buffer_mask) > 0 ? 127 : 0;
-            buffer_mask = buffer_mask >> 1;
-            ptr++;
-        }
-    }
-
-    // Re-sample the 128-bit audio buffer at the specified rate
-    float position = 0.0f;
-    float step = playback_rate / AUDIO_PLAYBACK_RATE;
-    Uint8 new_buffer[10000];
-    ptr = 0;
-
-    while (position < 128.0f) {
-        new_buffer[ptr] = expanded_buffer[(int) position];
-        position += step;
-        ptr++;
-    }
-
-    // If an audio chunk is playing, stop it so we can unload the chunk data
-    if (audio_chunk.alen != 0) {
-        Mix_HaltChannel(AUDIO_CHANNEL);
-        free(audio_chunk.abuf);
-        audio_chunk.abuf = NULL;
-        audio_chunk.alen = 0;
-    }
-
-    // Figure out how big we need to make the audio buffer
-    int copies = (int) (MIN_AUDIO_SAMPLES / ptr);
-    audio_chunk.abuf = (Uint8 *)malloc(copies * ptr);
-    for (int x = 0; x < copies; x++) {
-        for (int y = 0; y < ptr; y++) {
-            audio_chunk.abuf[audio_chunk.alen] = new_buffer[y];
-            audio_chunk.alen++;
-        }
-    }
-    audio_chunk.volume = MIX_MAX_VOLUME;
-
-    // Play the new sound if sound should be playing
-    if (audio_playing) {
-        Mix_PlayChannel(AUDIO_CHANNEL, &audio_chunk, -1);
-    }
-}
-
-/******************************************************************************/
-
 /**
  * Fx07 - LOAD Vx, DELAY 
  * 
@@ -1384,6 +1518,7 @@ move_register_into_sound(void)
 {
     int x = (cpu.operand.WORD & 0x0F00) >> 8;
     cpu.st = cpu.v[x];
+    audio_set_gate(cpu.st > 0);
     sprintf(cpu.opdesc, "LOAD SOUND, V%X", x);
 }
 
@@ -1473,7 +1608,8 @@ load_pitch(void)
 {
     int x = (cpu.operand.WORD & 0x0F00) >> 8;
     pitch = cpu.v[x];
-    playback_rate = 4000.0 * pow(2.0, (((float) pitch - 64.0) / 48.0));
+    playback_rate = audio_pitch_rate(pitch);
+    audio_update();
     sprintf(cpu.opdesc, "PITCH V%X (%X)", x, cpu.v[x]);
 }
 
@@ -1563,43 +1699,251 @@ read_registers_from_rpl(void)
 /******************************************************************************/
 
 /**
- * This function contains the main CPU execution loop. It is responsible for 
- * checking the SDL event structure for input events. It then fetches and 
+ * This function contains the main CPU execution loop. It fetches and 
  * decodes the next instruction, executes it and restarts the loop. This 
- * process continues until the `cpu.state` flag is set to `CPU_STOP`. It also
- * will decrement timers when the `decrement_timers` flag is set to `TRUE`.
+ * process continues until the `cpu.state` flag is set to `CPU_STOP`. A new
+ * frame starts once the instructions allowed for the current one have run
+ * and the timer has ticked (see `cpu_frame_ready`). At that point the timers
+ * are decremented and the completed frame is published to the presenter. The
+ * input queue is drained at the start of each frame, and also every
+ * `poll_interval` instructions within a frame if it is set, and any input
+ * script commands due for the frame are applied at the same point. When
+ * running ahead, the frame published is the one `run_ahead` frames further
+ * on, run with the input just applied (see `cpu_run_ahead`). Once the
+ * instructions allowed for a frame have run, or while FX0A waits for a key,
+ * the thread sleeps until the timer signals the next tick (or a key press
+ * wakes it), rather than spinning. If the CPU falls behind the timer, the
+ * frames it missed run back to back until it has caught up. When running
+ * unthrottled, a frame ends as soon as its instructions have run (waiting for
+ * a keypress uses up instructions too), so frames run as fast as possible and
+ * always hold the same number of instructions. Once the loop ends, the other
+ * threads see `cpu_stopped` return TRUE, and the presenter is woken so that
+ * it notices.
  */
 void 
 cpu_execute(void)
 {
+    script_advance();
     while (cpu.state != CPU_STOP) {
+        if (cpu_background_mode() == BACKGROUND_PAUSE) {
+            // Nothing runs until the window comes back, but keep the sound
+            // off and watch for a quit
+            audio_set_gate(FALSE);
+            cpu_process_input();
+            SDL_SemWaitTimeout(cpu_tick, CPU_TICK_TIMEOUT);
+            continue;
+        }
         if (awaiting_keypress != 1) {
             if (tick_counter < max_ticks) {
                 cpu_execute_single();
                 tick_counter++;
+                if (poll_interval > 0 && tick_counter % poll_interval == 0) {
+                    cpu_process_input();
+                }
+            }
+        } else {
+            // Nothing runs until a key arrives, so keep watching for one
+            cpu_process_input();
+            if (unthrottled) {
+                tick_counter++;
             }
-            if (decrement_timers) {
+        }
+        if (cpu_frame_ready()) {
+            tick_counter = 0;
+            decrement_timers = TRUE;
+        }
+        if (decrement_timers) {
+            realtime_frame_mark();
+            if (awaiting_keypress != 1) {
                 cpu.dt -= (cpu.dt > 0) ? 1 : 0;
                 cpu.st -= (cpu.st > 0) ? 1 : 0;
-                decrement_timers = FALSE;
+            }
+            decrement_timers = FALSE;
+            audio_advance_frame();
+            audio_set_gate(cpu.st > 0);
+            if (!run_ahead) {
+                frame_publish();
+            }
+            record_capture();
+            shm_publish();
+            if (print_hashes && wav_filename != NULL) {
+                printf("%016llx %016llx\n", (unsigned long long) screen_hash(), (unsigned long long) audio_frame_hash());
+                fflush(stdout);
+            } else if (print_hashes) {
+                printf("%016llx\n", (unsigned long long) screen_hash());
+                fflush(stdout);
+            }
+            cpu_process_input();
+            script_advance();
+            if (run_ahead) {
+                cpu_run_ahead();
             }
         }
-        cpu_process_sdl_events();
 
-        if (cpu.st > 0 && !audio_playing) {
-            if (audio_chunk.alen > 0) {
-                Mix_PlayChannel(AUDIO_CHANNEL, &audio_chunk, -1);
-                audio_playing = TRUE;
-            }
+        // The frame is over (or FX0A is waiting for a key), so sleep until
+        // the next tick or a key press
+        if (!unthrottled && !decrement_timers && (tick_counter >= max_ticks || awaiting_keypress)) {
+            SDL_SemWaitTimeout(cpu_tick, CPU_TICK_TIMEOUT);
         }
+    }
+    SDL_AtomicSet(&cpu_stop_flag, TRUE);
+    frame_wake();
+}
 
-        if (cpu.st == 0 && audio_playing) {
-            if (audio_chunk.alen > 0) {
-                Mix_HaltChannel(AUDIO_CHANNEL);
-                audio_playing = FALSE;
-            }
+/******************************************************************************/
+
+/**
+ * Saves everything but memory (the CPU, the screen and the sound settings)
+ * into a snapshot.
+ *
+ * @param snapshot where to save the state
+ */
+static void
+cpu_save_machine(chip8snapshot *snapshot)
+{
+    snapshot->cpu = cpu;
+    snapshot->display = display;
+    snapshot->screen_mode = screen_mode;
+    snapshot->awaiting_keypress = awaiting_keypress;
+    snapshot->playback_rate = playback_rate;
+    snapshot->pitch = pitch;
+    snapshot->bitplane = bitplane;
+    memcpy(snapshot->audio_pattern_buffer, audio_pattern_buffer, sizeof(audio_pattern_buffer));
+}
+
+/******************************************************************************/
+
+/**
+ * Puts everything but memory back into the state held by a snapshot.
+ *
+ * @param snapshot the state to restore
+ */
+static void
+cpu_restore_machine(const chip8snapshot *snapshot)
+{
+    cpu = snapshot->cpu;
+    display = snapshot->display;
+    screen_mode = snapshot->screen_mode;
+    awaiting_keypress = snapshot->awaiting_keypress;
+    playback_rate = snapshot->playback_rate;
+    pitch = snapshot->pitch;
+    bitplane = snapshot->bitplane;
+    memcpy(audio_pattern_buffer, snapshot->audio_pattern_buffer, sizeof(audio_pattern_buffer));
+
+    // The display changed behind the back of the row hashes
+    screen_mark_dirty(~(Uint64) 0);
+}
+
+/******************************************************************************/
+
+/**
+ * Runs a whole frame straight away: the instructions allowed for one frame,
+ * followed by a tick of the timers. The frame ends early if the CPU stops or
+ * waits for a key, or if drawing waits for the vertical blank. Nothing is
+ * published.
+ */
+void
+cpu_run_frame(void)
+{
+    for (tick_counter = 0; tick_counter < max_ticks; tick_counter++) {
+        if (awaiting_keypress || cpu.state == CPU_STOP) {
+            break;
         }
+        cpu_execute_single();
+    }
+    if (!awaiting_keypress) {
+        cpu.dt -= (cpu.dt > 0) ? 1 : 0;
+        cpu.st -= (cpu.st > 0) ? 1 : 0;
+    }
+}
+
+/******************************************************************************/
+
+/**
+ * Runs `run_ahead` frames ahead with the current input, publishes the last
+ * of them to the presenter, and then rolls back. The player sees the effect
+ * of a key press up to `run_ahead` frames sooner, while the real frames (and
+ * everything recorded, hashed or heard from them) are unchanged.
+ *
+ * Only the memory pages written since the last roll back are copied into the
+ * checkpoint, and only the pages written while running ahead are copied back.
+ */
+void
+cpu_run_ahead(void)
+{
+    Uint64 start = SDL_GetPerformanceCounter();
+    int saved_tick_counter = tick_counter;
+
+    cpu_save_machine(&cpu_snapshot);
+    cpu_run_ahead_pages += memory_copy_dirty(cpu_snapshot.memory, memory);
+    memory_clear_dirty();
+    audio_hold(TRUE);
+    for (int n = 0; n < run_ahead; n++) {
+        cpu_run_frame();
+    }
+    frame_publish();
+    audio_hold(FALSE);
+    cpu_restore_machine(&cpu_snapshot);
+    cpu_run_ahead_pages += memory_copy_dirty(memory, cpu_snapshot.memory);
+    memory_clear_dirty();
+    tick_counter = saved_tick_counter;
+
+    Uint64 elapsed = SDL_GetPerformanceCounter() - start;
+    cpu_run_ahead_count++;
+    cpu_run_ahead_total += elapsed;
+    if (elapsed > cpu_run_ahead_worst) {
+        cpu_run_ahead_worst = elapsed;
     }
 }
 
+/******************************************************************************/
+
+/**
+ * Prints how long running ahead took per frame, on average and at worst,
+ * compared to the length of a frame, and how many memory pages it copied.
+ */
+void
+cpu_print_run_ahead_stats(void)
+{
+    double frequency = (double) SDL_GetPerformanceFrequency();
+    double average = cpu_run_ahead_count ? cpu_run_ahead_total / frequency / cpu_run_ahead_count : 0;
+
+    printf("Run-ahead of %d frames over %u frames:\n", run_ahead, cpu_run_ahead_count);
+    printf("  average %.3f ms, worst %.3f ms per frame (a frame is %.1f ms)\n",
+           average * 1000.0, cpu_run_ahead_worst / frequency * 1000.0, 1000.0 / SCREEN_VERTREFRESH);
+    printf("  %.1f of %d memory pages copied per frame\n",
+           cpu_run_ahead_count ? (double) cpu_run_ahead_pages / cpu_run_ahead_count : 0.0, MEM_PAGES);
+}
+
+/******************************************************************************/
+
+/**
+ * Returns TRUE once the CPU execution loop has finished. Safe to call from
+ * any thread.
+ *
+ * @returns TRUE if the CPU has stopped, FALSE otherwise
+ */
+int
+cpu_stopped(void)
+{
+    return SDL_AtomicGet(&cpu_stop_flag);
+}
+
+/******************************************************************************/
+
+/**
+ * The entry point for the CPU thread. Runs the CPU execution loop until the
+ * CPU is stopped.
+ *
+ * @param data unused
+ * @returns always 0
+ */
+int
+cpu_thread(void *data)
+{
+    realtime_enter_thread(REALTIME_CPU);
+    cpu_execute();
+    return 0;
+}
+
 /* E N D   O F   F I L E ******************************************************/
@@ -10,6 +10,9 @@
 /* I N C L U D E S ************************************************************/
 
 #include <CUnit/CUnit.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
 #include "globals.h"
 
 /* F U N C T I O N S **********************************************************/
@@ -36,12 +39,15 @@ void
 setup_cpu_screen_test(void) 
 {
     scale_factor = 1;
+    video = video_select("memory");
     CU_TEST_FATAL(screen_init());
+    CU_TEST_FATAL(video->init());
 }
 
 void 
 teardown_cpu_screen_test(void)
 {
+    video->destroy();
     screen_destroy();
 }
 
@@ -1766,6 +1772,71 @@ test_exit_interpreter(void)
     teardown();
 }
 
+void
+test_cpu_stopped_after_execute(void)
+{
+    int saved_max_ticks = max_ticks;
+    int saved_unthrottled = unthrottled;
+
+    setup();
+    tword.WORD = 0x00FD;
+    address.WORD = CPU_PC_START;
+    memory_write_word(address, tword);
+    cpu.state = CPU_RUNNING;
+    max_ticks = 10;
+    unthrottled = TRUE;
+    CU_ASSERT_FALSE(cpu_stopped());
+    cpu_execute();
+    CU_ASSERT_TRUE(cpu_stopped());
+
+    cpu_reset();
+    CU_ASSERT_FALSE(cpu_stopped());
+    max_ticks = saved_max_ticks;
+    unthrottled = saved_unthrottled;
+    teardown();
+}
+
+void
+test_draw_sprite_display_wait_quirks(void)
+{
+    setup();
+    setup_cpu_screen_test();
+    display_wait_quirks = TRUE;
+    max_ticks = 10;
+    tick_counter = 2;
+    bitplane = 1;
+    tword.WORD = 0xD015;
+    address.WORD = 0x0000;
+    memory_write_word(address, tword);
+    cpu.pc.WORD = 0x0000;
+    cpu_execute_single();
+    CU_ASSERT_EQUAL(10, tick_counter);
+    display_wait_quirks = FALSE;
+    tick_counter = 0;
+    teardown();
+    teardown_cpu_screen_test();
+}
+
+void
+test_draw_sprite_no_display_wait_quirks(void)
+{
+    setup();
+    setup_cpu_screen_test();
+    display_wait_quirks = FALSE;
+    max_ticks = 10;
+    tick_counter = 2;
+    bitplane = 1;
+    tword.WORD = 0xD015;
+    address.WORD = 0x0000;
+    memory_write_word(address, tword);
+    cpu.pc.WORD = 0x0000;
+    cpu_execute_single();
+    CU_ASSERT_EQUAL(2, tick_counter);
+    tick_counter = 0;
+    teardown();
+    teardown_cpu_screen_test();
+}
+
 void
 test_cpu_scroll_left(void)
 {
@@ -1892,4 +1963,335 @@ test_cpu_disable_extended_mode(void)
     teardown_cpu_screen_test();
 }
 
+void
+test_cpu_process_input_drains_queue(void)
+{
+    setup();
+    keyboard_set_state(0);
+    input_init();
+    input_push(INPUT_KEYDOWN, SDLK_1);
+    input_push(INPUT_KEYDOWN, SDLK_2);
+    input_push(INPUT_KEYUP, SDLK_1);
+    cpu.operand.WORD = 0xF30A;
+    awaiting_keypress = TRUE;
+
+    // Every pending event is handled in a single call
+    cpu_process_input();
+    CU_ASSERT_EQUAL(0x0004, keyboard_get_state());
+    CU_ASSERT_EQUAL(1, cpu.v[3]);
+    CU_ASSERT_FALSE(awaiting_keypress);
+
+    chip8input input;
+    CU_ASSERT_FALSE(input_pop(&input));
+    keyboard_set_state(0);
+    teardown();
+}
+
+void
+test_cpu_run_ahead_restores_machine(void)
+{
+    byte program[] = {
+        0x73, 0x33, 0xA3, 0x00, 0xF3, 0x55, 0x00, 0xFF,
+        0xF2, 0x01, 0xD0, 0x05, 0xF0, 0x0A
+    };
+    int saved_max_ticks = max_ticks;
+
+    // 7333 A300 F355 00FF F201 D005 F00A - changes the registers, memory,
+    // screen mode, bitplane and display, and then waits for a key
+    setup();
+    setup_cpu_screen_test();
+    memcpy(&memory[0x200], program, sizeof(program));
+    cpu.v[3] = 0x33;
+    Uint64 hash = screen_hash();
+    max_ticks = 10;
+    run_ahead = 1;
+    frame_init();
+
+    cpu_run_ahead();
+    chip8frame *frame = frame_acquire();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(frame);
+    CU_ASSERT_EQUAL(SCREEN_MODE_EXTENDED, frame->screen_mode);
+    CU_ASSERT_NOT_EQUAL(hash, frame->hash);
+
+    CU_ASSERT_EQUAL(0x33, cpu.v[3]);
+    CU_ASSERT_EQUAL(0x200, cpu.pc.WORD);
+    CU_ASSERT_EQUAL(0, cpu.i.WORD);
+    CU_ASSERT_EQUAL(0, memory[0x303]);
+    CU_ASSERT_EQUAL(SCREEN_MODE_NORMAL, screen_mode);
+    CU_ASSERT_FALSE(awaiting_keypress);
+    CU_ASSERT_EQUAL(1, bitplane);
+    CU_ASSERT_EQUAL(hash, screen_hash());
+
+    run_ahead = 0;
+    max_ticks = saved_max_ticks;
+    teardown_cpu_screen_test();
+    teardown();
+}
+
+void
+test_cpu_run_frame(void)
+{
+    int saved_max_ticks = max_ticks;
+
+    // 7001 1200 - each pass of the loop takes 2 instructions
+    setup();
+    max_ticks = 10;
+    memory[0x200] = 0x70;
+    memory[0x201] = 0x01;
+    memory[0x202] = 0x12;
+    memory[0x203] = 0x00;
+    cpu.dt = 3;
+    cpu_run_frame();
+    CU_ASSERT_EQUAL(5, cpu.v[0]);
+    CU_ASSERT_EQUAL(2, cpu.dt);
+
+    // Waiting for a key ends the frame and holds the timers
+    memory[0x200] = 0xF1;
+    memory[0x201] = 0x0A;
+    cpu.pc.WORD = 0x200;
+    cpu_run_frame();
+    CU_ASSERT_TRUE(awaiting_keypress);
+    CU_ASSERT_EQUAL(0x202, cpu.pc.WORD);
+    CU_ASSERT_EQUAL(2, cpu.dt);
+
+    max_ticks = saved_max_ticks;
+    teardown();
+}
+
+void
+test_cpu_run_ahead_publishes_future_frame(void)
+{
+    byte program[] = { 0x70, 0x01, 0xA2, 0x00, 0x00, 0xE0, 0xD0, 0x05, 0x12, 0x00 };
+    int saved_max_ticks = max_ticks;
+
+    // 7001 A200 00E0 D005 1200 - moves a sprite one pixel right every frame
+    setup();
+    setup_cpu_screen_test();
+    memcpy(&memory[0x200], program, sizeof(program));
+    max_ticks = 5;
+    run_ahead = 2;
+    frame_init();
+
+    // The published frame is 2 frames ahead, but the machine has not moved on
+    Uint64 hash = screen_hash();
+    cpu_run_ahead();
+    chip8frame *frame = frame_acquire();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(frame);
+    CU_ASSERT_NOT_EQUAL(hash, frame->hash);
+    CU_ASSERT_EQUAL(0x200, cpu.pc.WORD);
+    CU_ASSERT_EQUAL(0, cpu.v[0]);
+    CU_ASSERT_EQUAL(hash, screen_hash());
+
+    // Once the real frames catch up, they draw what was published
+    cpu_run_frame();
+    cpu_run_frame();
+    CU_ASSERT_EQUAL(frame->hash, screen_hash());
+
+    run_ahead = 0;
+    max_ticks = saved_max_ticks;
+    teardown_cpu_screen_test();
+    teardown();
+}
+
+void
+test_cpu_frame_deadline(void)
+{
+    Uint64 start = 5000000000ULL;
+
+    // Deadlines are 16666666 or 16666667 ns apart, and never drift
+    CU_ASSERT_EQUAL(start, cpu_frame_deadline(start, 0));
+    CU_ASSERT_EQUAL(start + 16666666, cpu_frame_deadline(start, 1));
+    CU_ASSERT_EQUAL(start + 33333333, cpu_frame_deadline(start, 2));
+    CU_ASSERT_EQUAL(start + 50000000, cpu_frame_deadline(start, 3));
+    CU_ASSERT_EQUAL(start + 1000000000, cpu_frame_deadline(start, 60));
+    CU_ASSERT_EQUAL(start + 3600000000000ULL, cpu_frame_deadline(start, 216000));
+}
+
+void
+test_memory_wraps_near_top_of_index(void)
+{
+    setup();
+    for (int n = 0; n < 8; n++) {
+        memory[0xFFF8 + n] = 0xA0 + n;
+        memory[n] = 0xB0 + n;
+    }
+
+    // FF65 with I = FFF8 reads FFF8 - FFFF, then 0000 - 0007
+    cpu.i.WORD = 0xFFF8;
+    cpu.operand.WORD = 0xFF65;
+    load_registers_from_memory();
+    for (int r = 0; r < 8; r++) {
+        CU_ASSERT_EQUAL(0xA0 + r, cpu.v[r]);
+        CU_ASSERT_EQUAL(0xB0 + r, cpu.v[r + 8]);
+    }
+
+    cpu.i.WORD = 0xFFF8;
+    load_audio_pattern_buffer();
+    CU_ASSERT_EQUAL(0xA7, audio_pattern_buffer[7]);
+    CU_ASSERT_EQUAL(0xB0, audio_pattern_buffer[8]);
+    CU_ASSERT_EQUAL(0xB7, audio_pattern_buffer[15]);
+
+    // Writes wrap too, and reads just before the start wrap to the end
+    address.WORD = 0xFFFF;
+    tword.WORD = 0x1234;
+    memory_write_word(address, tword);
+    CU_ASSERT_EQUAL(0x12, memory_read(0xFFFF));
+    CU_ASSERT_EQUAL(0x34, memory_read(0x0000));
+    CU_ASSERT_EQUAL(0x12, memory_read(-1));
+    CU_ASSERT_EQUAL(0x34, memory_read(0x10000));
+    teardown();
+}
+
+void
+test_draw_extended_sprite_wraps_near_top_of_index(void)
+{
+    setup();
+    setup_cpu_screen_test();
+    memset(memory, 0, 16);
+    memset(&memory[0xFFF0], 0xFF, 16);
+
+    // Rows 0 - 7 come from FFF0 - FFFF, rows 8 - 15 from 0000 - 000F
+    cpu.i.WORD = 0xFFF0;
+    draw_extended_sprite(0, 0, 1, cpu.i.WORD);
+    CU_ASSERT_EQUAL(1, get_pixel(0, 0, 1));
+    CU_ASSERT_EQUAL(1, get_pixel(15, 7, 1));
+    CU_ASSERT_EQUAL(0, get_pixel(0, 8, 1));
+    CU_ASSERT_EQUAL(0, get_pixel(15, 15, 1));
+    teardown_cpu_screen_test();
+    teardown();
+}
+
+void
+test_memory_write_marks_dirty_pages(void)
+{
+    setup();
+    CU_ASSERT_EQUAL(~(Uint64) 0, memory_dirty[0]);
+    CU_ASSERT_EQUAL(~(Uint64) 0, memory_dirty[3]);
+    memory_clear_dirty();
+
+    address.WORD = 0x0234;
+    memory_write(address, 0x12);
+    CU_ASSERT_EQUAL((Uint64) 1 << 0x02, memory_dirty[0]);
+
+    // A word that straddles two pages marks both, even at the top
+    address.WORD = 0x12FF;
+    tword.WORD = 0xABCD;
+    memory_write_word(address, tword);
+    CU_ASSERT_EQUAL((Uint64) 1 << 0x02 | (Uint64) 1 << 0x12 | (Uint64) 1 << 0x13, memory_dirty[0]);
+    address.WORD = 0xFFFF;
+    memory_write_word(address, tword);
+    CU_ASSERT_EQUAL((Uint64) 1 << 0x02 | (Uint64) 1 << 0x12 | (Uint64) 1 << 0x13 | 1, memory_dirty[0]);
+    CU_ASSERT_EQUAL(0, memory_dirty[1]);
+    CU_ASSERT_EQUAL((Uint64) 1 << 63, memory_dirty[3]);
+
+    // Only the dirty pages are copied
+    byte *copy = calloc(MEM_SIZE, 1);
+    CU_ASSERT_EQUAL(5, memory_copy_dirty(copy, memory));
+    CU_ASSERT_EQUAL(0x12, copy[0x0234]);
+    CU_ASSERT_EQUAL(0xAB, copy[0x12FF]);
+    CU_ASSERT_EQUAL(0xCD, copy[0x1300]);
+    CU_ASSERT_EQUAL(0xAB, copy[0xFFFF]);
+    CU_ASSERT_EQUAL(0xCD, copy[0x0000]);
+    memory[0x4000] = 0x55;
+    memory_copy_dirty(copy, memory);
+    CU_ASSERT_EQUAL(0, copy[0x4000]);
+    free(copy);
+
+    memory_clear_dirty();
+    CU_ASSERT_EQUAL(0, memory_dirty[0]);
+    teardown();
+}
+
+void
+test_cpu_run_ahead_rolls_back_memory(void)
+{
+    byte program[] = { 0x70, 0x01, 0xA3, 0x00, 0xF0, 0x55, 0x12, 0x00 };
+    int saved_max_ticks = max_ticks;
+
+    // 7001 A300 F055 1200 - counts frames in V0 and stores it at 0300
+    setup();
+    setup_cpu_screen_test();
+    memcpy(&memory[0x200], program, sizeof(program));
+    max_ticks = 4;
+    run_ahead = 3;
+    frame_init();
+
+    // Running ahead stores 3 frames further on, but each roll back (copying
+    // only the dirty pages) leaves exactly what the real frames stored
+    for (int frame = 1; frame <= 5; frame++) {
+        cpu_run_frame();
+        cpu_run_ahead();
+        CU_ASSERT_EQUAL(frame, cpu.v[0]);
+        CU_ASSERT_EQUAL(frame, memory[0x300]);
+        CU_ASSERT_EQUAL(0, memory_dirty[0]);
+    }
+
+    run_ahead = 0;
+    max_ticks = saved_max_ticks;
+    teardown_cpu_screen_test();
+    teardown();
+}
+
+void
+test_cpu_run_ahead_repeats_random_numbers(void)
+{
+    byte program[] = { 0xC0, 0xFF, 0xC1, 0xFF, 0xC2, 0xFF, 0x12, 0x00 };
+    byte expected[5][3];
+    int saved_max_ticks = max_ticks;
+
+    // C0FF C1FF C2FF 1200 - fills V0 to V2 with random numbers every frame
+    setup();
+    setup_cpu_screen_test();
+    memcpy(&memory[0x200], program, sizeof(program));
+    max_ticks = 4;
+    cpu.random = 0x12345678;
+    frame_init();
+    for (int frame = 0; frame < 5; frame++) {
+        cpu_run_frame();
+        memcpy(expected[frame], cpu.v, 3);
+    }
+
+    // Frames run ahead draw numbers too, but rolling them back also rolls
+    // back the generator, so the real frames draw the same numbers
+    cpu_reset();
+    cpu.random = 0x12345678;
+    run_ahead = 3;
+    frame_init();
+    for (int frame = 0; frame < 5; frame++) {
+        cpu_run_frame();
+        cpu_run_ahead();
+        CU_ASSERT_EQUAL(0, memcmp(expected[frame], cpu.v, 3));
+    }
+
+    run_ahead = 0;
+    max_ticks = saved_max_ticks;
+    teardown_cpu_screen_test();
+    teardown();
+}
+
+void
+test_memory_guard_pages_fault(void)
+{
+    long page = sysconf(_SC_PAGESIZE);
+    int status;
+
+    CU_ASSERT_FALSE(memory_init(100));
+    setup();
+
+    // Past the mirror on either side, an access faults instead of landing
+    // somewhere else in the emulator
+    for (int side = 0; side < 2; side++) {
+        pid_t child = fork();
+        CU_ASSERT_FATAL(child >= 0);
+        if (child == 0) {
+            volatile byte value = memory_read(side == 0 ? -page - 1 : MEM_SIZE + page);
+            (void) value;
+            _exit(0);
+        }
+        waitpid(child, &status, 0);
+        CU_ASSERT_TRUE(WIFSIGNALED(status) && WTERMSIG(status) == SIGSEGV);
+    }
+    teardown();
+}
+
 /* E N D   O F   F I L E ******************************************************/
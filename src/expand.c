@@ -0,0 +1,389 @@
+/**
+ * Copyright (C) 2025 Craig Thomas
+ * This project uses an MIT style license - see the LICENSE file for details.
+ *
+ * @file      expand.c
+ * @brief     Routines for converting the bitplanes into pixels
+ * @author    Craig Thomas
+ *
+ * The display is stored as two packed bitplanes. Before it can be shown, each
+ * pair of bits must be turned into a 2-bit color index, and the index looked
+ * up in the 4 color palette to produce an ARGB8888 pixel. The routines in this
+ * file perform that conversion, optionally replicating each pixel horizontally
+ * and vertically to perform software scaling.
+ *
+ * There are three versions of the conversion kernel - a portable scalar
+ * version, an SSE2 version that converts 4 pixels at a time, and an AVX2
+ * version that converts 8 pixels at a time. Call `expand_init` once at
+ * startup to pick the fastest version that the host CPU supports. After that,
+ * `expand_bitplanes` will always use the selected kernel.
+ */
+
+/* I N C L U D E S ************************************************************/
+
+#include <string.h>
+#include "globals.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define EXPAND_X86 1
+#include <immintrin.h>
+#endif
+
+/* L O C A L S ****************************************************************/
+
+/*!
+ * Converts a single packed row into SCREEN_WIDTH pixels
+ */
+typedef void (*expand_row_func)(const byte *plane_1, const byte *plane_2, Uint32 *dest, const Uint32 *palette);
+
+/*!
+ * Replicates each of count pixels x_scale times
+ */
+typedef void (*expand_replicate_func)(const Uint32 *source, Uint32 *dest, int count, int x_scale);
+
+/*!
+ * The kernels selected by expand_init
+ */
+static int expand_kernel = EXPAND_SCALAR;
+
+/* F U N C T I O N S **********************************************************/
+
+/**
+ * Converts a single row of the bitplanes into pixels one pixel at a time.
+ *
+ * @param plane_1 the packed row from the first bitplane
+ * @param plane_2 the packed row from the second bitplane
+ * @param dest where to write the SCREEN_WIDTH converted pixels
+ * @param palette the 4 colors to use for the pixels
+ */
+static void
+expand_row_scalar(const byte *plane_1, const byte *plane_2, Uint32 *dest, const Uint32 *palette)
+{
+    for (int x_byte = 0; x_byte < SCREEN_ROW_BYTES; x_byte++) {
+        byte bits_1 = plane_1[x_byte];
+        byte bits_2 = plane_2[x_byte];
+        for (int bit = 7; bit >= 0; bit--) {
+            *dest++ = palette[((bits_1 >> bit) & 1) | (((bits_2 >> bit) & 1) << 1)];
+        }
+    }
+}
+
+/******************************************************************************/
+
+/**
+ * Replicates each pixel in the source x_scale times one pixel at a time.
+ *
+ * @param source the pixels to replicate
+ * @param dest where to write the count * x_scale replicated pixels
+ * @param count the number of source pixels
+ * @param x_scale how many times to repeat each pixel
+ */
+static void
+expand_replicate_scalar(const Uint32 *source, Uint32 *dest, int count, int x_scale)
+{
+    for (int x = 0; x < count; x++) {
+        Uint32 color = source[x];
+        for (int repeat = 0; repeat < x_scale; repeat++) {
+            *dest++ = color;
+        }
+    }
+}
+
+#ifdef EXPAND_X86
+
+/******************************************************************************/
+
+/**
+ * Converts a single row of the bitplanes into pixels 4 pixels at a time. Each
+ * bitplane byte is broadcast into all 4 lanes, and compared against the bit
+ * for that lane to build a mask. The masks then select between the colors.
+ *
+ * @param plane_1 the packed row from the first bitplane
+ * @param plane_2 the packed row from the second bitplane
+ * @param dest where to write the SCREEN_WIDTH converted pixels
+ * @param palette the 4 colors to use for the pixels
+ */
+__attribute__((target("sse2")))
+static void
+expand_row_sse2(const byte *plane_1, const byte *plane_2, Uint32 *dest, const Uint32 *palette)
+{
+    const __m128i high_bits = _mm_set_epi32(0x10, 0x20, 0x40, 0x80);
+    const __m128i low_bits = _mm_set_epi32(0x01, 0x02, 0x04, 0x08);
+    const __m128i color_0 = _mm_set1_epi32(palette[0]);
+    const __m128i color_1 = _mm_set1_epi32(palette[1]);
+    const __m128i color_2 = _mm_set1_epi32(palette[2]);
+    const __m128i color_3 = _mm_set1_epi32(palette[3]);
+
+    for (int x_byte = 0; x_byte < SCREEN_ROW_BYTES; x_byte++) {
+        __m128i bits_1 = _mm_set1_epi32(plane_1[x_byte]);
+        __m128i bits_2 = _mm_set1_epi32(plane_2[x_byte]);
+        for (int half = 0; half < 2; half++) {
+            __m128i lane_bits = half ? low_bits : high_bits;
+            __m128i mask_1 = _mm_cmpeq_epi32(_mm_and_si128(bits_1, lane_bits), lane_bits);
+            __m128i mask_2 = _mm_cmpeq_epi32(_mm_and_si128(bits_2, lane_bits), lane_bits);
+            __m128i low = _mm_or_si128(_mm_and_si128(mask_1, color_1), _mm_andnot_si128(mask_1, color_0));
+            __m128i high = _mm_or_si128(_mm_and_si128(mask_1, color_3), _mm_andnot_si128(mask_1, color_2));
+            __m128i result = _mm_or_si128(_mm_and_si128(mask_2, high), _mm_andnot_si128(mask_2, low));
+            _mm_storeu_si128((__m128i *)dest, result);
+            dest += 4;
+        }
+    }
+}
+
+/******************************************************************************/
+
+/**
+ * Replicates each pixel in the source x_scale times, storing 4 pixels at a
+ * time. When the scale is 4 or more, the last store for each pixel may
+ * overlap the previous one so that no partial stores are needed.
+ *
+ * @param source the pixels to replicate
+ * @param dest where to write the count * x_scale replicated pixels
+ * @param count the number of source pixels
+ * @param x_scale how many times to repeat each pixel
+ */
+__attribute__((target("sse2")))
+static void
+expand_replicate_sse2(const Uint32 *source, Uint32 *dest, int count, int x_scale)
+{
+    if (x_scale == 2) {
+        for (int x = 0; x < count; x += 4) {
+            __m128i pixels = _mm_loadu_si128((const __m128i *)(source + x));
+            _mm_storeu_si128((__m128i *)dest, _mm_unpacklo_epi32(pixels, pixels));
+            _mm_storeu_si128((__m128i *)(dest + 4), _mm_unpackhi_epi32(pixels, pixels));
+            dest += 8;
+        }
+        return;
+    }
+
+    if (x_scale < 4) {
+        expand_replicate_scalar(source, dest, count, x_scale);
+        return;
+    }
+
+    for (int x = 0; x < count; x++) {
+        __m128i color = _mm_set1_epi32(source[x]);
+        int repeat = 0;
+        for (; repeat + 4 <= x_scale; repeat += 4) {
+            _mm_storeu_si128((__m128i *)(dest + repeat), color);
+        }
+        if (repeat < x_scale) {
+            _mm_storeu_si128((__m128i *)(dest + x_scale - 4), color);
+        }
+        dest += x_scale;
+    }
+}
+
+/******************************************************************************/
+
+/**
+ * Converts a single row of the bitplanes into pixels 8 pixels at a time. Each
+ * lane shifts its own bit down from the broadcast bitplane bytes to form the
+ * color index, which is then used to permute the colors out of the palette.
+ *
+ * @param plane_1 the packed row from the first bitplane
+ * @param plane_2 the packed row from the second bitplane
+ * @param dest where to write the SCREEN_WIDTH converted pixels
+ * @param palette the 4 colors to use for the pixels
+ */
+__attribute__((target("avx2")))
+static void
+expand_row_avx2(const byte *plane_1, const byte *plane_2, Uint32 *dest, const Uint32 *palette)
+{
+    const __m256i shifts = _mm256_set_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i colors = _mm256_set_epi32(
+        palette[3], palette[2], palette[1], palette[0],
+        palette[3], palette[2], palette[1], palette[0]
+    );
+
+    for (int x_byte = 0; x_byte < SCREEN_ROW_BYTES; x_byte++) {
+        __m256i bits_1 = _mm256_srlv_epi32(_mm256_set1_epi32(plane_1[x_byte]), shifts);
+        __m256i bits_2 = _mm256_srlv_epi32(_mm256_set1_epi32(plane_2[x_byte]), shifts);
+        __m256i index = _mm256_or_si256(
+            _mm256_and_si256(bits_1, one),
+            _mm256_slli_epi32(_mm256_and_si256(bits_2, one), 1)
+        );
+        _mm256_storeu_si256((__m256i *)dest, _mm256_permutevar8x32_epi32(colors, index));
+        dest += 8;
+    }
+}
+
+/******************************************************************************/
+
+/**
+ * Replicates each pixel in the source x_scale times, storing 8 pixels at a
+ * time. Small scales fall back to the SSE2 version.
+ *
+ * @param source the pixels to replicate
+ * @param dest where to write the count * x_scale replicated pixels
+ * @param count the number of source pixels
+ * @param x_scale how many times to repeat each pixel
+ */
+__attribute__((target("avx2")))
+static void
+expand_replicate_avx2(const Uint32 *source, Uint32 *dest, int count, int x_scale)
+{
+    if (x_scale < 8) {
+        expand_replicate_sse2(source, dest, count, x_scale);
+        return;
+    }
+
+    for (int x = 0; x < count; x++) {
+        __m256i color = _mm256_set1_epi32(source[x]);
+        int repeat = 0;
+        for (; repeat + 8 <= x_scale; repeat += 8) {
+            _mm256_storeu_si256((__m256i *)(dest + repeat), color);
+        }
+        if (repeat < x_scale) {
+            _mm256_storeu_si256((__m256i *)(dest + x_scale - 8), color);
+        }
+        dest += x_scale;
+    }
+}
+
+#endif
+
+/******************************************************************************/
+
+/**
+ * Selects the fastest kernel that the host CPU supports. Returns the kernel
+ * that was selected.
+ *
+ * @returns one of EXPAND_SCALAR, EXPAND_SSE2 or EXPAND_AVX2
+ */
+int
+expand_init(void)
+{
+    expand_kernel = EXPAND_SCALAR;
+#ifdef EXPAND_X86
+    if (SDL_HasAVX2()) {
+        expand_kernel = EXPAND_AVX2;
+    } else if (SDL_HasSSE2()) {
+        expand_kernel = EXPAND_SSE2;
+    }
+#endif
+    return expand_kernel;
+}
+
+/******************************************************************************/
+
+/**
+ * Returns TRUE if the host CPU can run the specified kernel.
+ *
+ * @param kernel one of EXPAND_SCALAR, EXPAND_SSE2 or EXPAND_AVX2
+ * @returns TRUE if the kernel is supported, FALSE otherwise
+ */
+int
+expand_is_supported(int kernel)
+{
+    switch (kernel) {
+        case EXPAND_SCALAR:
+            return TRUE;
+
+#ifdef EXPAND_X86
+        case EXPAND_SSE2:
+            return SDL_HasSSE2() ? TRUE : FALSE;
+
+        case EXPAND_AVX2:
+            return SDL_HasAVX2() ? TRUE : FALSE;
+#endif
+
+        default:
+            return FALSE;
+    }
+}
+
+/******************************************************************************/
+
+/**
+ * Returns a printable name for the specified kernel.
+ *
+ * @param kernel one of EXPAND_SCALAR, EXPAND_SSE2 or EXPAND_AVX2
+ * @returns the name of the kernel
+ */
+const char *
+expand_kernel_name(int kernel)
+{
+    switch (kernel) {
+        case EXPAND_SSE2:
+            return "sse2";
+
+        case EXPAND_AVX2:
+            return "avx2";
+
+        default:
+            return "scalar";
+    }
+}
+
+/******************************************************************************/
+
+/**
+ * Converts both bitplanes of the display into ARGB8888 pixels using the
+ * specified kernel. Each pixel is repeated x_scale times horizontally, and
+ * each row is repeated y_scale times vertically, so the destination must
+ * hold SCREEN_WIDTH * x_scale by SCREEN_HEIGHT * y_scale pixels. The kernel
+ * must be one that expand_is_supported reports as available.
+ *
+ * @param kernel one of EXPAND_SCALAR, EXPAND_SSE2 or EXPAND_AVX2
+ * @param source the display to convert
+ * @param pixels the destination pixels
+ * @param pitch the length of one destination row in bytes
+ * @param palette the 4 colors to use for the pixels
+ * @param x_scale how many times to repeat each pixel horizontally
+ * @param y_scale how many times to repeat each row vertically
+ */
+void
+expand_bitplanes_with(int kernel, const chip8display *source, Uint32 *pixels, int pitch,
+                      const Uint32 *palette, int x_scale, int y_scale)
+{
+    expand_row_func expand_row = expand_row_scalar;
+    expand_replicate_func replicate = expand_replicate_scalar;
+    Uint32 line[SCREEN_WIDTH];
+
+#ifdef EXPAND_X86
+    if (kernel == EXPAND_SSE2) {
+        expand_row = expand_row_sse2;
+        replicate = expand_replicate_sse2;
+    } else if (kernel == EXPAND_AVX2) {
+        expand_row = expand_row_avx2;
+        replicate = expand_replicate_avx2;
+    }
+#endif
+
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        Uint32 *dest = (Uint32 *)((Uint8 *)pixels + (y * y_scale * pitch));
+        if (x_scale == 1) {
+            expand_row(source->plane[0][y], source->plane[1][y], dest, palette);
+        } else {
+            expand_row(source->plane[0][y], source->plane[1][y], line, palette);
+            replicate(line, dest, SCREEN_WIDTH, x_scale);
+        }
+        for (int repeat = 1; repeat < y_scale; repeat++) {
+            memcpy((Uint8 *)dest + (repeat * pitch), dest, SCREEN_WIDTH * x_scale * sizeof(Uint32));
+        }
+    }
+}
+
+/******************************************************************************/
+
+/**
+ * Converts both bitplanes of the display into ARGB8888 pixels using the kernel
+ * selected by expand_init. See expand_bitplanes_with for details.
+ *
+ * @param source the display to convert
+ * @param pixels the destination pixels
+ * @param pitch the length of one destination row in bytes
+ * @param palette the 4 colors to use for the pixels
+ * @param x_scale how many times to repeat each pixel horizontally
+ * @param y_scale how many times to repeat each row vertically
+ */
+void
+expand_bitplanes(const chip8display *source, Uint32 *pixels, int pitch,
+                 const Uint32 *palette, int x_scale, int y_scale)
+{
+    expand_bitplanes_with(expand_kernel, source, pixels, pitch, palette, x_scale, y_scale);
+}
+
+/* E N D   O F   F I L E ******************************************************/
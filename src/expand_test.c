@@ -0,0 +1,95 @@
+/**
+ * Copyright (C) 2025 Craig Thomas
+ * This project uses an MIT style license - see the LICENSE file for details.
+ *
+ * @file      expand_test.c
+ * @brief     Tests for the pixel expansion functions
+ * @author    Craig Thomas
+ */
+
+/* I N C L U D E S ************************************************************/
+
+#include <CUnit/CUnit.h>
+#include "globals.h"
+
+/* L O C A L S ****************************************************************/
+
+static const Uint32 test_palette[4] = { 0x00000000, 0xFF111111, 0x00222222, 0x00333333 };
+
+/* F U N C T I O N S **********************************************************/
+
+void
+setup_expand_test(chip8display *source)
+{
+    memset(source, 0, sizeof(chip8display));
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        for (int x = 0; x < SCREEN_ROW_BYTES; x++) {
+            source->plane[0][y][x] = (byte) ((y * 37) + (x * 11));
+            source->plane[1][y][x] = (byte) ((y * 13) ^ (x * 71));
+        }
+    }
+}
+
+void
+test_expand_scalar_colors(void)
+{
+    chip8display source;
+    Uint32 *pixels = malloc(SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(Uint32));
+    memset(&source, 0, sizeof(source));
+    source.plane[0][0][0] = 0x80;
+    source.plane[1][0][0] = 0x40;
+    source.plane[0][0][0] |= 0x20;
+    source.plane[1][0][0] |= 0x20;
+    expand_bitplanes_with(EXPAND_SCALAR, &source, pixels, SCREEN_WIDTH * sizeof(Uint32), test_palette, 1, 1);
+    CU_ASSERT_EQUAL(test_palette[1], pixels[0]);
+    CU_ASSERT_EQUAL(test_palette[2], pixels[1]);
+    CU_ASSERT_EQUAL(test_palette[3], pixels[2]);
+    CU_ASSERT_EQUAL(test_palette[0], pixels[3]);
+    CU_ASSERT_EQUAL(test_palette[0], pixels[SCREEN_WIDTH]);
+    free(pixels);
+}
+
+void
+test_expand_scalar_scaling(void)
+{
+    chip8display source;
+    int width = SCREEN_WIDTH * 3;
+    Uint32 *pixels = malloc(width * SCREEN_HEIGHT * 2 * sizeof(Uint32));
+    memset(&source, 0, sizeof(source));
+    source.plane[0][1][0] = 0x40;
+    expand_bitplanes_with(EXPAND_SCALAR, &source, pixels, width * sizeof(Uint32), test_palette, 3, 2);
+    for (int y = 2; y < 4; y++) {
+        CU_ASSERT_EQUAL(test_palette[0], pixels[(y * width) + 2]);
+        CU_ASSERT_EQUAL(test_palette[1], pixels[(y * width) + 3]);
+        CU_ASSERT_EQUAL(test_palette[1], pixels[(y * width) + 5]);
+        CU_ASSERT_EQUAL(test_palette[0], pixels[(y * width) + 6]);
+    }
+    CU_ASSERT_EQUAL(test_palette[0], pixels[(1 * width) + 3]);
+    CU_ASSERT_EQUAL(test_palette[0], pixels[(4 * width) + 3]);
+    free(pixels);
+}
+
+void
+test_expand_kernels_match_scalar(void)
+{
+    chip8display source;
+    setup_expand_test(&source);
+    for (int kernel = EXPAND_SSE2; kernel <= EXPAND_AVX2; kernel++) {
+        if (!expand_is_supported(kernel)) {
+            continue;
+        }
+        for (int scale = 1; scale <= 10; scale++) {
+            int width = SCREEN_WIDTH * scale;
+            size_t size = width * SCREEN_HEIGHT * scale * sizeof(Uint32);
+            Uint32 *expected = malloc(size);
+            Uint32 *actual = malloc(size);
+            expand_bitplanes_with(EXPAND_SCALAR, &source, expected, width * sizeof(Uint32), test_palette, scale, scale);
+            expand_bitplanes_with(kernel, &source, actual, width * sizeof(Uint32), test_palette, scale, scale);
+            CU_ASSERT_EQUAL(0, memcmp(expected, actual, size));
+            free(expected);
+            free(actual);
+        }
+    }
+}
+
+/* E N D   O F   F I L E ******************************************************/
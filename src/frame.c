@@ -0,0 +1,172 @@
+/**
+ * Copyright (C) 2025 Craig Thomas
+ * This project uses an MIT style license - see the LICENSE file for details.
+ *
+ * @file      frame.c
+ * @brief     Routines for handing completed frames to the presenter
+ * @author    Craig Thomas
+ *
+ * The CPU runs on its own thread, while the window is owned by the main
+ * thread. Completed frames are passed between the two using a lock-free
+ * triple buffer. The CPU thread always owns one of the three buffers (the
+ * back buffer), the presenter always owns one (the front buffer), and the
+ * third buffer sits in the middle holding the most recently completed frame.
+ *
+ * Publishing a frame copies the display into the back buffer and then swaps
+ * it with the middle buffer, marking the middle buffer as fresh. Acquiring a
+ * frame swaps the front buffer with the middle buffer if it is fresh. Both
+ * swaps are a single atomic exchange, so neither side ever waits for the
+ * other, and a slow presenter simply skips frames.
+ *
+ * Publishing a frame also wakes the presenter, so that it can sleep until
+ * there is something to present rather than polling. Backends with a window
+ * wait for SDL events, so an SDL_USEREVENT is pushed for them, while the
+ * backends without one block in `frame_wait` instead.
+ */
+
+/* I N C L U D E S ************************************************************/
+
+#include "globals.h"
+
+/* D E F I N E S **************************************************************/
+
+#define FRAME_INDEX_MASK 0x3    /**< Index of the middle buffer in the state  */
+#define FRAME_FRESH      0x4    /**< Middle buffer holds an unseen frame      */
+
+/* L O C A L S ****************************************************************/
+
+/*!
+ * The three frame buffers
+ */
+static chip8frame frame_buffers[3];
+
+/*!
+ * The index of the middle buffer, along with the FRAME_FRESH flag
+ */
+static SDL_atomic_t frame_state;
+
+/*!
+ * The buffer owned by the CPU thread
+ */
+static int frame_back;
+
+/*!
+ * The buffer owned by the presenter
+ */
+static int frame_front;
+
+/*!
+ * The number of frames published so far
+ */
+static Uint32 frame_count;
+
+/*!
+ * Posted when the presenter has something to do, for `frame_wait`
+ */
+static SDL_sem *frame_signal;
+
+/* F U N C T I O N S **********************************************************/
+
+/**
+ * Resets the triple buffer so that no frame is available to the presenter.
+ */
+void
+frame_init(void)
+{
+    memset(frame_buffers, 0, sizeof(frame_buffers));
+    frame_back = 0;
+    SDL_AtomicSet(&frame_state, 1);
+    frame_front = 2;
+    frame_count = 0;
+
+    if (frame_signal == NULL) {
+        frame_signal = SDL_CreateSemaphore(0);
+    }
+    while (SDL_SemTryWait(frame_signal) == 0) {
+    }
+}
+
+/******************************************************************************/
+
+/**
+ * Publishes the current contents of the display as a completed frame, along
+ * with its hash. Must only be called from the CPU thread.
+ */
+void
+frame_publish(void)
+{
+    chip8frame *frame = &frame_buffers[frame_back];
+    memcpy(&frame->display, &display, sizeof(chip8display));
+    frame->screen_mode = screen_mode;
+    frame->number = ++frame_count;
+    frame->hash = screen_hash();
+    frame->published = SDL_GetPerformanceCounter();
+
+    int old_state = SDL_AtomicSet(&frame_state, frame_back | FRAME_FRESH);
+    frame_back = old_state & FRAME_INDEX_MASK;
+
+    // Nothing is presented while skipping frames in the background, so let
+    // the presenter sleep (the frame is picked up once the window is back)
+    if (cpu_background_mode() != BACKGROUND_SKIP) {
+        frame_wake();
+    }
+}
+
+/******************************************************************************/
+
+/**
+ * Wakes the presenter, whether it is waiting for SDL events or in
+ * `frame_wait`. Called when a frame is published, and when the CPU stops.
+ * Wakes do not pile up, so however many arrive, the next wait returns once.
+ */
+void
+frame_wake(void)
+{
+    SDL_Event event;
+
+    if (frame_signal != NULL && SDL_SemValue(frame_signal) == 0) {
+        SDL_SemPost(frame_signal);
+    }
+    memset(&event, 0, sizeof(event));
+    event.type = SDL_USEREVENT;
+    SDL_PushEvent(&event);
+}
+
+/******************************************************************************/
+
+/**
+ * Waits for the presenter to be woken by `frame_wake`. Returns FALSE if it
+ * was not woken within the timeout.
+ *
+ * @param timeout the longest time to wait (in milliseconds), or
+ *        SDL_MUTEX_MAXWAIT to wait for as long as it takes
+ * @returns TRUE if the presenter was woken, FALSE otherwise
+ */
+int
+frame_wait(Uint32 timeout)
+{
+    return SDL_SemWaitTimeout(frame_signal, timeout) == 0;
+}
+
+/******************************************************************************/
+
+/**
+ * Returns the most recently published frame if the presenter has not seen it
+ * yet, or NULL if no new frame has been published. The frame remains valid
+ * until the next call. Must only be called from the presenter thread.
+ *
+ * @returns the newest frame, or NULL if there is no new frame
+ */
+chip8frame *
+frame_acquire(void)
+{
+    if (!(SDL_AtomicGet(&frame_state) & FRAME_FRESH)) {
+        return NULL;
+    }
+
+    int old_state = SDL_AtomicSet(&frame_state, frame_front);
+    frame_front = old_state & FRAME_INDEX_MASK;
+    return &frame_buffers[frame_front];
+}
+
+/* E N D   O F   F I L E ******************************************************/
@@ -0,0 +1,82 @@
+/**
+ * Copyright (C) 2025 Craig Thomas
+ * This project uses an MIT style license - see the LICENSE file for details.
+ *
+ * @file      frame_test.c
+ * @brief     Tests for the frame handoff functions
+ * @author    Craig Thomas
+ */
+
+/* I N C L U D E S ************************************************************/
+
+#include <CUnit/CUnit.h>
+#include "globals.h"
+
+/* F U N C T I O N S **********************************************************/
+
+void
+test_frame_acquire_empty(void)
+{
+    frame_init();
+    CU_ASSERT_PTR_NULL(frame_acquire());
+}
+
+void
+test_frame_acquire_returns_newest(void)
+{
+    frame_init();
+    memset(&display, 0, sizeof(display));
+    display.plane[0][0][0] = 0x01;
+    frame_publish();
+    display.plane[0][0][0] = 0x02;
+    frame_publish();
+    display.plane[0][0][0] = 0x03;
+    frame_publish();
+
+    chip8frame *frame = frame_acquire();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(frame);
+    CU_ASSERT_EQUAL(0x03, frame->display.plane[0][0][0]);
+    CU_ASSERT_EQUAL(3, frame->number);
+    memset(&display, 0, sizeof(display));
+}
+
+void
+test_frame_acquire_only_once(void)
+{
+    frame_init();
+    frame_publish();
+    CU_ASSERT_PTR_NOT_NULL(frame_acquire());
+    CU_ASSERT_PTR_NULL(frame_acquire());
+    frame_publish();
+    CU_ASSERT_PTR_NOT_NULL(frame_acquire());
+}
+
+void
+test_frame_publish_hash(void)
+{
+    frame_init();
+    CU_TEST_FATAL(screen_init());
+    draw_pixel(3, 4, 1, 1);
+    frame_publish();
+
+    chip8frame *frame = frame_acquire();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(frame);
+    CU_ASSERT_EQUAL(screen_hash_display(&frame->display, frame->screen_mode), frame->hash);
+    screen_destroy();
+}
+
+void
+test_frame_publish_wakes_presenter(void)
+{
+    frame_init();
+    CU_ASSERT_FALSE(frame_wait(0));
+    frame_publish();
+    frame_publish();
+    CU_ASSERT_TRUE(frame_wait(0));
+    CU_ASSERT_FALSE(frame_wait(0));
+    frame_wake();
+    CU_ASSERT_TRUE(frame_wait(0));
+    CU_ASSERT_PTR_NOT_NULL(frame_acquire());
+}
+
+/* E N D   O F   F I L E ******************************************************/
@@ -18,12 +18,14 @@
 
 /* Memory */
 byte *memory;                  /**< Pointer to emulator memory region         */
+Uint64 memory_dirty[MEM_PAGES / 64]; /**< One bit per page written since the last checkpoint */
 
 /* Screen */
 SDL_Window *window;            /**< Stores the main screen SDL structure      */
-SDL_Surface *surface;          /**< Stores the Chip 8 virtual screen          */
+chip8display display;          /**< Stores the Chip 8 virtual screen          */
 SDL_Renderer *renderer;        /**< Stores the screen renderer                */
 SDL_Texture *texture;          /**< The SDL texture to render                 */
+chip8video *video;             /**< The video backend presenting frames       */
 int scale;                     /**< The scale factor applied to the screen    */
 int screen_mode;               /**< Whether the screen is in extended mode    */
 int scale_factor;              /**< Stores the current scale factor           */
@@ -36,7 +38,9 @@ Uint32 COLOR_3;                /**< Bitplane 3 color                          */
 
 /* CPU */
 chip8regset cpu;               /**< The main emulator CPU                     */
-SDL_TimerID cpu_timer;         /**< A CPU tick timer                          */
+SDL_Thread *cpu_timer;         /**< The thread that ticks 60 times a second   */
+SDL_sem *cpu_tick;             /**< Posted by the timer on every tick         */
+SDL_Thread *cpu_thread_handle; /**< The thread running the CPU                */
 unsigned long cpu_interrupt;   /**< The CPU interrupt routine                 */
 int decrement_timers;          /**< Flags CPU to decrement DELAY and SOUND    */
 int op_delay;                  /**< Millisecond delay on the CPU              */
@@ -45,8 +49,6 @@ float playback_rate;           /**< The playback rate for audio               */
 int pitch;                     /**< The pitch for the current audio sample    */
 int bitplane;                  /**< Sets the current drawing plane            */
 byte audio_pattern_buffer[16]; /**< Stores the audio pattern buffer           */
-Mix_Chunk audio_chunk;         /**< The currently created audio chunk         */
-int audio_playing;             /**< Stores whether audio is playing           */
 int tick_counter;              /**< Stores how many ticks have been executed  */
 
 /* Event captures */
@@ -58,7 +60,22 @@ int shift_quirks;              /**< Stores whether shift quirks are turned on */
 int index_quirks;              /**< Stores whether index quirks are turned on */
 int logic_quirks;              /**< Stores whether logic quirks are turned on */
 int clip_quirks;               /**< Stores whether clip quirks are turned on  */
+int display_wait_quirks;       /**< Whether drawing waits for vertical blank  */
 int max_ticks;                 /**< Stores how many ticks per second allowed  */
+int print_hashes;              /**< Print the screen hash of every frame      */
+char *record_filename;         /**< The file to record video to, or NULL      */
+char *shm_name;                /**< Shared memory segment to export, or NULL  */
+char *wav_filename;            /**< The file to render audio to, or NULL      */
+int unthrottled;               /**< Run frames as fast as possible            */
+int audio_stats;               /**< Print audio statistics on exit            */
+char *keymap_filename;         /**< The keymap file to load, or NULL          */
+int poll_interval;             /**< Instructions between input polls, or 0    */
+char *script_filename;         /**< The input script to follow, or NULL       */
+int latency_stats;             /**< Measure and print input latency           */
+int run_ahead;                 /**< Frames to run ahead of the input, or 0    */
+char *realtime_cores;          /**< Cores to pin to in realtime mode, or NULL */
+int jitter_stats;              /**< Print frame time statistics on exit       */
+int background_policy;         /**< What to do when the window is hidden      */
 
 
 /* E N D   O F   F I L E ******************************************************/
\ No newline at end of file
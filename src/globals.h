@@ -17,7 +17,6 @@
 
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_keycode.h>
-#include <SDL2/SDL_mixer.h>
 
 /* D E F I N E S **************************************************************/
 
@@ -25,6 +24,8 @@
 #define MEM_SIZE       0x10000   /**< Defines a 64K memory size               */
 #define SP_START       0x52      /**< Defines the start of the system stack   */
 #define ROM_DEFAULT    0x200	   /**< Defines the default ROM load point      */
+#define MEM_PAGE_SIZE  0x100     /**< Bytes covered by each dirty page bit    */
+#define MEM_PAGES      (MEM_SIZE / MEM_PAGE_SIZE) /**< Number of memory pages */
 
 /* Screen */
 #define SCREEN_HEIGHT      64    /**< Default screen height                   */
@@ -35,6 +36,20 @@
 #define SCREEN_MODE_EXTENDED 1   /**< The extended screen mode                */
 #define PIXEL_COLOR        250   /**< Color to use for drawing pixels         */
 #define SCREEN_VERTREFRESH 60    /**< Sets the vertical refresh (in Hz)       */
+#define SCREEN_PLANES      2     /**< Number of XO Chip bitplanes             */
+#define SCREEN_ROW_BYTES   (SCREEN_WIDTH / 8) /**< Bytes in a packed row      */
+
+/* What to do while the window is hidden, minimized or unfocused */
+#define BACKGROUND_RUN     0     /**< Carry on as if the window were in front */
+#define BACKGROUND_PAUSE   1     /**< Stop emulating until the window is back */
+#define BACKGROUND_SKIP    2     /**< Keep emulating, but present nothing     */
+#define BACKGROUND_SLOW    3     /**< Emulate one frame in BACKGROUND_SLOWDOWN */
+#define BACKGROUND_SLOWDOWN 4    /**< How many times slower the slow policy is */
+
+/* Pixel expansion kernels */
+#define EXPAND_SCALAR      0     /**< Portable one pixel at a time kernel     */
+#define EXPAND_SSE2        1     /**< SSE2 kernel, 4 pixels at a time         */
+#define EXPAND_AVX2        2     /**< AVX2 kernel, 8 pixels at a time         */
 
 /* CPU */
 #define CPU_RUNNING    1          /**< Continues CPU execution                */
@@ -42,16 +57,68 @@
 #define CPU_STOP       0          /**< Halts the CPU and quits                */
 #define CPU_OPTIME     1000       /**< CPU tick length (in nanoseconds)       */
 #define CPU_PC_START   0x200      /**< The start address of the PC            */
-#define AUDIO_PLAYBACK_RATE 48000 /**< The audio playback rate in Hz          */
-#define MIN_AUDIO_SAMPLES 3200    /**< The minimum number of audio samples    */
-#define AUDIO_CHANNEL  1          /**< The audio channel to play sounds on    */
 #define DEFAULT_MAX_TICKS 1000    /**< The maximum instructions per second    */
+#define CPU_TICK_TIMEOUT  17      /**< Longest sleep between ticks (in ms)    */
+#define CPU_MAX_RUN_AHEAD 8       /**< Most frames allowed to run ahead       */
+#define CPU_MAX_CATCHUP_FRAMES 4  /**< Most frames the CPU may fall behind    */
+
+/* Audio */
+#define AUDIO_PLAYBACK_RATE 48000 /**< The default playback rate in Hz       */
+#define AUDIO_MIN_RATE    8000    /**< The lowest playback rate in Hz         */
+#define AUDIO_MAX_RATE    192000  /**< The highest playback rate in Hz        */
+#define AUDIO_SAMPLES     512     /**< Default samples per audio callback     */
+#define AUDIO_MIN_SAMPLES 32      /**< Fewest samples per audio callback      */
+#define AUDIO_MAX_SAMPLES 8192    /**< Most samples per audio callback        */
+#define AUDIO_SILENCE     128     /**< The unsigned 8-bit silence level       */
+#define AUDIO_AMPLITUDE   63      /**< Distance of the wave from silence      */
+#define AUDIO_MAX_DRIFT_FRAMES 8  /**< Clock drift before the mixer resyncs   */
+
+/* Audio events passed from the CPU thread to the audio callback */
+#define AUDIO_QUEUE_SIZE  256     /**< Number of queued events (a power of two) */
+#define AUDIO_EVENT_RESET 1       /**< Silence, rewind and load a new sound   */
+#define AUDIO_EVENT_SOUND 2       /**< Load a new pattern and playback rate   */
+#define AUDIO_EVENT_GATE  3       /**< The sound timer started or stopped     */
 
 /* Keyboard */
 #define KEY_NUMBEROFKEYS 16   /**< Defines the number of keys on the keyboard */
 
+/* Input events passed from the main thread to the CPU thread */
+#define INPUT_QUEUE_SIZE 256  /**< Number of queued events (a power of two)   */
+#define INPUT_KEYDOWN    1    /**< A key was pressed                          */
+#define INPUT_KEYUP      2    /**< A key was released                         */
+#define INPUT_QUIT       3    /**< The emulator should shut down              */
+
+/* Input latency statistics */
+#define LATENCY_QUEUE_SIZE 256 /**< Samples awaiting a frame (a power of two) */
+#define LATENCY_BUCKETS    1000 /**< Histogram buckets, the last is overflow  */
+#define LATENCY_BUCKET_US  100  /**< Width of each bucket (in microseconds)   */
+#define LATENCY_STAGES     4    /**< Number of stages measured                */
+#define LATENCY_QUEUE      0    /**< Waiting in the input queue               */
+#define LATENCY_EMULATE    1    /**< Handled until the frame is published     */
+#define LATENCY_PRESENT    2    /**< Published until the frame is presented   */
+#define LATENCY_TOTAL      3    /**< Queued until the frame is presented      */
+
+/* Realtime mode */
+#define REALTIME_THREADS 3    /**< Number of kinds of emulator thread         */
+#define REALTIME_CPU     0    /**< The CPU thread                             */
+#define REALTIME_TIMER   1    /**< The timer thread                           */
+#define REALTIME_AUDIO   2    /**< The audio callback thread                  */
+
+/* Captures passed from the CPU thread to the recording thread */
+#define RECORD_QUEUE_SIZE  64 /**< Number of queued captures (a power of two) */
+#define CAPTURE_FRAME      1  /**< A frame of the recording                   */
+#define CAPTURE_SCREENSHOT 2  /**< A screenshot to save as a PNG              */
+#define CAPTURE_END        3  /**< The end of the recording                   */
+
+/* Shared memory export */
+#define SHM_MAGIC         0x43385348 /**< Marks a valid segment ("C8SH")      */
+#define SHM_VERSION       1     /**< Layout version of chip8shared            */
+#define SHM_READ_ATTEMPTS 16    /**< Tries before a reader gives up           */
+
 /* Keyboard special keys */
-#define QUIT_KEY   SDLK_ESCAPE /**< Quits the emulator                        */
+#define QUIT_KEY       SDLK_ESCAPE /**< Quits the emulator                    */
+#define SCREENSHOT_KEY SDLK_F12    /**< Saves a screenshot                    */
+#define LATENCY_KEY    SDLK_F11    /**< Prints input latency statistics       */
 
 /* Other generic definitions */
 #define TRUE          1
@@ -94,18 +161,141 @@ typedef struct {
     char *opdesc;      /**< A string representation of the current opcode     */
     int state;         /**< The current state of the CPU                      */
     byte rpl[0x10];    /**< RPL register storage                              */
+    Uint32 random;     /**< Random number generator state (never zero)        */
 } chip8regset;
 
+/**
+ * The chip8display structure holds the contents of the screen. Each of the
+ * two bitplanes is stored at the native 128 x 64 resolution, packed 8 pixels
+ * to a byte, with the most significant bit being the leftmost pixel. In
+ * normal mode, each logical pixel covers a 2 x 2 block of native pixels.
+ */
+typedef struct {
+    byte plane[SCREEN_PLANES][SCREEN_HEIGHT][SCREEN_ROW_BYTES]; /**< Bitplanes */
+} chip8display;
+
+/**
+ * A completed frame, as handed from the CPU thread to the presenter.
+ */
+typedef struct {
+    chip8display display;  /**< The contents of the screen                    */
+    int screen_mode;       /**< Whether the screen was in extended mode       */
+    Uint32 number;         /**< Counts up by one for each published frame     */
+    Uint64 hash;           /**< The screen_hash of the display and mode       */
+    Uint64 published;      /**< Performance counter when it was published     */
+} chip8frame;
+
+/**
+ * A video backend, which is responsible for presenting completed frames and
+ * collecting host events. See video.c for the available backends.
+ */
+typedef struct {
+    const char *name;                            /**< Name used to select it    */
+    int needs_window;                            /**< Whether it opens a window */
+    int (*init)(void);                           /**< Sets up the backend       */
+    void (*present)(const chip8frame *frame);    /**< Presents a frame          */
+    void (*process_events)(void);                /**< Collects host events      */
+    void (*destroy)(void);                       /**< Tears down the backend    */
+} chip8video;
+
+/**
+ * A capture, as handed from the CPU thread to the recording thread.
+ */
+typedef struct {
+    int type;              /**< One of the CAPTURE_ types                     */
+    Uint32 number;         /**< The frame number of the capture               */
+    chip8display display;  /**< The contents of the screen                    */
+} chip8capture;
+
+/**
+ * The contents of the shared memory segment that the screen is exported to.
+ * Only fixed size types are used, since the segment is read by other
+ * processes. See shm.c for the locking protocol.
+ */
+typedef struct {
+    Uint32 magic;          /**< SHM_MAGIC once the segment is set up          */
+    Uint32 version;        /**< SHM_VERSION                                   */
+    Uint32 size;           /**< The size of this structure                    */
+    Uint32 pid;            /**< The process ID of the emulator                */
+    Uint32 sequence;       /**< Sequence lock, odd while being updated        */
+    Uint32 frame;          /**< Counts up by one for each published frame     */
+    Uint32 screen_mode;    /**< Whether the screen is in extended mode        */
+    Uint32 palette[4];     /**< The ARGB8888 bitplane colors                  */
+    byte v[0x10];          /**< V registers                                   */
+    byte rpl[0x10];        /**< RPL register storage                          */
+    Uint16 i;              /**< Index register                                */
+    Uint16 pc;             /**< Program Counter register                      */
+    Uint16 sp;             /**< Stack Pointer register                        */
+    byte dt;               /**< Delay Timer register                          */
+    byte st;               /**< Sound Timer register                          */
+    chip8display display;  /**< The contents of the screen                    */
+} chip8shared;
+
+/**
+ * An audio event, as handed from the CPU thread to the audio callback.
+ */
+typedef struct {
+    Uint64 time;           /**< Guest time of the event, in samples           */
+    Uint64 host_time;      /**< Performance counter when the event was sent   */
+    int type;              /**< One of the AUDIO_EVENT_ types                 */
+    int gate;              /**< Whether the sound timer is running            */
+    Uint32 step;           /**< Phase step for the playback rate              */
+    byte pattern[16];      /**< The audio pattern buffer                      */
+} chip8audioevent;
+
+/**
+ * A snapshot of the emulated machine, used to roll back after running ahead.
+ */
+typedef struct {
+    chip8regset cpu;               /**< The CPU registers                     */
+    byte memory[MEM_SIZE];         /**< The contents of memory                */
+    chip8display display;          /**< The contents of the screen            */
+    int screen_mode;               /**< Whether the screen is in extended mode*/
+    int awaiting_keypress;         /**< Whether FX0A is waiting for a key     */
+    float playback_rate;           /**< The playback rate for audio           */
+    int pitch;                     /**< The pitch for the audio pattern       */
+    int bitplane;                  /**< The current drawing plane             */
+    byte audio_pattern_buffer[16]; /**< The audio pattern buffer              */
+} chip8snapshot;
+
+/**
+ * An input event, as handed from the main thread to the CPU thread.
+ */
+typedef struct {
+    int type;              /**< One of the INPUT_ event types                 */
+    SDL_Keycode key;       /**< The key that was pressed or released          */
+    Uint64 time;           /**< Performance counter when it was queued        */
+} chip8input;
+
+/**
+ * An input event waiting for the frame that shows its effect.
+ */
+typedef struct {
+    Uint64 pushed;         /**< Performance counter when it was queued        */
+    Uint64 popped;         /**< Performance counter when the CPU handled it   */
+} chip8latencysample;
+
+/**
+ * A command from an input script.
+ */
+typedef struct {
+    Uint32 frame;          /**< The frame at which the command takes effect   */
+    int type;              /**< INPUT_KEYDOWN, INPUT_KEYUP or INPUT_QUIT      */
+    int key;               /**< The emulator key pressed or released          */
+} chip8scriptcommand;
+
 /* G L O B A L S **************************************************************/
 
 /* Memory */
 extern byte *memory;                  /**< Pointer to emulator memory region         */
+extern Uint64 memory_dirty[MEM_PAGES / 64]; /**< One bit per page written since the last checkpoint */
 
 /* Screen */
 extern SDL_Window *window;            /**< Stores the main screen SDL structure      */
 extern SDL_Renderer *renderer;        /**< Stores the screen renderer                */
-extern SDL_Surface *surface;          /**< Stores the Chip 8 virtual screen          */
+extern chip8display display;          /**< Stores the Chip 8 virtual screen          */
 extern SDL_Texture *texture;          /**< The SDL texture to render                 */
+extern chip8video *video;             /**< The video backend presenting frames       */
 extern int scale_factor;              /**< The scale factor applied to the screen    */
 extern int screen_mode;               /**< Whether the screen is in extended mode    */
 
@@ -117,7 +307,9 @@ extern Uint32 COLOR_3;                /**< Bitplane 3 color
 
 /* CPU */
 extern chip8regset cpu;               /**< The main emulator CPU                     */
-extern SDL_TimerID cpu_timer;         /**< A CPU tick timer                          */
+extern SDL_Thread *cpu_timer;         /**< The thread that ticks 60 times a second   */
+extern SDL_sem *cpu_tick;             /**< Posted by the timer on every tick         */
+extern SDL_Thread *cpu_thread_handle; /**< The thread running the CPU                */
 extern unsigned long cpu_interrupt;   /**< The CPU interrupt routine                 */
 extern int decrement_timers;          /**< Flags CPU to decrement DELAY and SOUND    */
 extern int op_delay;                  /**< Millisecond delay on the CPU              */
@@ -126,8 +318,6 @@ extern float playback_rate;           /**< The playback rate for audio samples
 extern int pitch;                     /**< The pitch for the current audio sample    */
 extern int bitplane;                  /**< Sets the current drawing plane            */
 extern byte audio_pattern_buffer[16]; /**< Stores the audio pattern buffer           */
-extern Mix_Chunk audio_chunk;         /**< The currently created audio chunk         */
-extern int audio_playing;             /**< Stores whether audio is playing           */
 extern int tick_counter;              /**< Stores the number of instructions executed*/
 
 /* Event captures */
@@ -139,7 +329,22 @@ extern int shift_quirks;              /**< Stores whether shift quirks are turne
 extern int index_quirks;              /**< Stores whether index quirks are turned on */
 extern int logic_quirks;              /**< Stores whether logic quirks are turned on */
 extern int clip_quirks;               /**< Stores whether clip quirks are turned on  */
+extern int display_wait_quirks;       /**< Whether drawing waits for vertical blank  */
 extern int max_ticks;                 /**< Stores how many ticks per second we allow */
+extern int print_hashes;              /**< Print the screen hash of every frame      */
+extern char *record_filename;         /**< The file to record video to, or NULL      */
+extern char *shm_name;                /**< Shared memory segment to export, or NULL  */
+extern char *wav_filename;            /**< The file to render audio to, or NULL      */
+extern int unthrottled;               /**< Run frames as fast as possible            */
+extern int audio_stats;               /**< Print audio statistics on exit            */
+extern char *keymap_filename;         /**< The keymap file to load, or NULL          */
+extern int poll_interval;             /**< Instructions between input polls, or 0    */
+extern char *script_filename;         /**< The input script to follow, or NULL       */
+extern int latency_stats;             /**< Measure and print input latency           */
+extern int run_ahead;                 /**< Frames to run ahead of the input, or 0    */
+extern char *realtime_cores;          /**< Cores to pin to in realtime mode, or NULL */
+extern int jitter_stats;              /**< Print frame time statistics on exit       */
+extern int background_policy;         /**< What to do when the window is hidden      */
 
 /* Test variables */
 extern word tword;
@@ -149,8 +354,19 @@ extern word address;
 
 /* cpu.c */
 void cpu_reset(void);
+void cpu_timerinterrupt(void);
+Uint64 cpu_frame_deadline(Uint64 start, Uint64 frame);
 int cpu_timerinit(void);
+void cpu_timerdestroy(void);
+void cpu_keypress(int emulatorkey);
+int cpu_background_mode(void);
+void cpu_process_input(void);
+void cpu_run_frame(void);
+void cpu_run_ahead(void);
+void cpu_print_run_ahead_stats(void);
 void cpu_execute(void);
+int cpu_stopped(void);
+int cpu_thread(void *data);
 void cpu_execute_single(void);
 void scroll_down(void);
 void clear_screen(void);
@@ -201,25 +417,52 @@ void load_subset_of_registers_from_memory(void);
 void set_bitplane(void);
 void index_load_long(void);
 void load_audio_pattern_buffer(void);
-void calculate_audio_waveform(void);
+
+/* audio.c */
+int audio_frame_samples(void);
+int audio_latency(void);
+int audio_set_format(int rate, int buffer_samples);
+float audio_pitch_rate(int value);
+void audio_generate(Uint8 *stream, int length);
+void audio_set_queued(int queued);
+void audio_hold(int held);
+void audio_update(void);
+void audio_set_gate(int open);
+void audio_advance_frame(void);
+Uint64 audio_frame_hash(void);
+void audio_reset(void);
+int audio_dropped_events(void);
+int audio_wav_init(const char *filename);
+void audio_wav_destroy(void);
+int audio_init(void);
+void audio_destroy(void);
+void audio_print_stats(void);
 
 /* memory.c */
 int memory_init(int memorysize);
 void memory_destroy(void);
+void memory_mark_all_dirty(void);
+void memory_clear_dirty(void);
+int memory_copy_dirty(byte *target, const byte *source);
 
 /* screen.c */
 int screen_init(void);
 int screen_is_extended_mode(void);
-void screen_clear(Uint32 color); 
 void screen_blank(int bitplane);
+Uint32 get_bitplane_color(int plane);
 int get_pixel(int x, int y, int plane);
 void draw_pixel(int x, int y, int turn_on, int plane);
 void draw_extended_sprite(int x, int y, int plane, int active_index);
 void draw_normal_sprite(int x_pos, int y_pos, int num_bytes, int plane, int active_index);
-void screen_refresh(void);
+void screen_convert(const chip8display *source, Uint32 *pixels, int pitch);
+void screen_mark_dirty(Uint64 rows);
+Uint64 screen_hash_display(const chip8display *source, int mode);
+Uint64 screen_hash(void);
 void screen_destroy(void);
 void screen_set_extended_mode(void);
 void screen_set_normal_mode(void);
+void screen_shift_row_left(byte *row, int num_pixels);
+void screen_shift_row_right(byte *row, int num_pixels);
 void screen_scroll_left(int plane);
 void screen_scroll_right(int plane);
 void screen_scroll_down(int num_pixels, int plane);
@@ -228,11 +471,105 @@ int screen_get_height(void);
 int screen_get_width(void);
 int screen_get_mode_scale(void);
 
+/* expand.c */
+int expand_init(void);
+int expand_is_supported(int kernel);
+const char *expand_kernel_name(int kernel);
+void expand_bitplanes_with(int kernel, const chip8display *source, Uint32 *pixels, int pitch, const Uint32 *palette, int x_scale, int y_scale);
+void expand_bitplanes(const chip8display *source, Uint32 *pixels, int pitch, const Uint32 *palette, int x_scale, int y_scale);
+
+/* frame.c */
+void frame_init(void);
+void frame_publish(void);
+chip8frame *frame_acquire(void);
+void frame_wake(void);
+int frame_wait(Uint32 timeout);
+
+/* input.c */
+void input_init(void);
+int input_push(int type, SDL_Keycode key);
+int input_pop(chip8input *input);
+
+/* latency.c */
+void latency_reset(void);
+void latency_input(const chip8input *input);
+void latency_present(const chip8frame *frame);
+void latency_request_print(void);
+Uint32 latency_percentile(int stage, int percent);
+Uint32 latency_samples(void);
+void latency_print_stats(void);
+
+/* realtime.c */
+void realtime_prefault(void *block, size_t length);
+int realtime_init(const char *cores);
+void realtime_enter_thread(int thread);
+void realtime_frame_mark(void);
+void realtime_add_frame(Uint64 length);
+Uint64 realtime_jitter_percentile(int permille);
+void realtime_reset_stats(void);
+void realtime_print_stats(void);
+
+/* script.c */
+int script_init(const char *filename);
+void script_advance(void);
+void script_destroy(void);
+
+/* video.c */
+void video_process_sdl_events(int timeout);
+int video_sdl_init(void);
+void video_sdl_present(const chip8frame *frame);
+void video_sdl_process_events(void);
+void video_sdl_destroy(void);
+int video_null_init(void);
+void video_null_present(const chip8frame *frame);
+void video_null_process_events(void);
+void video_null_destroy(void);
+int video_memory_init(void);
+void video_memory_present(const chip8frame *frame);
+const Uint32 *video_memory_pixels(void);
+const chip8frame *video_memory_frame(void);
+chip8video *video_select(const char *name);
+void video_window_event(const SDL_WindowEvent *window_event);
+int video_in_background(void);
+int video_background_policy(const char *name);
+
+/* terminal.c */
+void terminal_reset(void);
+void terminal_render(const chip8frame *frame, int fd);
+void terminal_process_bytes(const char *buffer, int length);
+void terminal_process_escape(Uint32 now);
+int video_terminal_init(void);
+void video_terminal_present(const chip8frame *frame);
+void video_terminal_process_events(void);
+void video_terminal_destroy(void);
+
+/* record.c */
+void record_convert_indices(const chip8display *source, byte *indices);
+void record_gif_write_lzw(FILE *fp, const byte *indices);
+void record_write_png(FILE *fp, const chip8display *source);
+int record_init(const char *filename);
+void record_capture(void);
+void record_screenshot(void);
+Uint32 record_frames_encoded(void);
+void record_destroy(void);
+
+/* shm.c */
+int shm_init(const char *name);
+void shm_publish(void);
+void shm_destroy(void);
+const chip8shared *shm_attach(const char *name);
+void shm_detach(const chip8shared *shared);
+int shm_read(const chip8shared *shared, chip8shared *copy);
+
 /* keyboard.c */
 int keyboard_isemulatorkey(SDL_KeyCode key);
 int keyboard_checkforkeypress(int keycode);
 void keyboard_processkeydown(SDL_KeyCode key);
 void keyboard_processkeyup(SDL_KeyCode key);
+Uint16 keyboard_get_state(void);
+void keyboard_set_state(Uint16 state);
+void keyboard_use_default_keymap(void);
+int keyboard_load_keymap(const char *filename);
 
 /* cpu_test.c */
 void test_return_from_subroutine(void);
@@ -321,14 +658,28 @@ void test_load_subset_one_one(void);
 void test_load_subset_three_one(void);
 void test_load_subset_integration(void);
 void test_exit_interpreter(void);
+void test_cpu_stopped_after_execute(void);
 void test_cpu_scroll_left(void);
 void test_cpu_scroll_right(void);
 void test_cpu_scroll_down(void);
 void test_cpu_screen_blank(void);
 void test_cpu_enable_extended_mode(void);
 void test_cpu_disable_extended_mode(void);
+void test_cpu_process_input_drains_queue(void);
+void test_cpu_run_ahead_restores_machine(void);
+void test_cpu_run_frame(void);
+void test_cpu_run_ahead_publishes_future_frame(void);
+void test_cpu_frame_deadline(void);
+void test_memory_wraps_near_top_of_index(void);
+void test_draw_extended_sprite_wraps_near_top_of_index(void);
+void test_memory_guard_pages_fault(void);
+void test_memory_write_marks_dirty_pages(void);
+void test_cpu_run_ahead_rolls_back_memory(void);
+void test_cpu_run_ahead_repeats_random_numbers(void);
 void test_index_load_long(void);
 void test_index_load_long_integration(void);
+void test_draw_sprite_display_wait_quirks(void);
+void test_draw_sprite_no_display_wait_quirks(void);
 
 /* screen_test.c */
 void test_set_get_pixel(void);
@@ -355,12 +706,76 @@ void test_screen_scroll_up_bitplane_3_both_pixels_active(void);
 void test_screen_get_mode_scale_normal(void);
 void test_screen_get_mode_scale_extended(void);
 void test_screen_is_mode_extended_correct(void);
+void test_screen_hash_matches_full_hash(void);
+void test_screen_hash_changes(void);
+
+/* expand_test.c */
+void test_expand_scalar_colors(void);
+void test_expand_scalar_scaling(void);
+void test_expand_kernels_match_scalar(void);
+
+/* frame_test.c */
+void test_frame_acquire_empty(void);
+void test_frame_acquire_returns_newest(void);
+void test_frame_acquire_only_once(void);
+void test_frame_publish_hash(void);
+void test_frame_publish_wakes_presenter(void);
+
+/* input_test.c */
+void test_input_push_pop_in_order(void);
+void test_input_push_full_queue(void);
+void test_input_push_wakes_cpu(void);
+
+/* latency_test.c */
+void test_latency_stages(void);
+void test_latency_waits_for_later_frame(void);
+
+/* realtime_test.c */
+void test_realtime_jitter_stats(void);
+void test_realtime_init_rejects_bad_cores(void);
+
+/* script_test.c */
+void test_script_applies_commands_on_frames(void);
+void test_script_skips_bad_lines(void);
+
+/* video_test.c */
+void test_video_select_unknown_backend(void);
+void test_video_headless_backends_need_no_window(void);
+void test_video_memory_present(void);
+void test_video_window_event_background(void);
+void test_video_background_policy(void);
+void test_terminal_render_changed_cells(void);
+void test_terminal_process_bytes(void);
+void test_terminal_process_bytes_split_sequence(void);
+
+/* record_test.c */
+void test_record_rejects_unknown_format(void);
+void test_record_y4m_elides_duplicate_frames(void);
+void test_record_gif(void);
+void test_record_write_png(void);
+
+/* shm_test.c */
+void test_shm_publish_and_read(void);
+void test_shm_read_skips_update_in_progress(void);
+void test_shm_init_fails_while_segment_in_use(void);
+void test_shm_init_replaces_stale_segment(void);
+
+/* audio_test.c */
+void test_audio_generate_silent_when_gated(void);
+void test_audio_generate_plays_pattern(void);
+void test_audio_load_pitch_changes_rate(void);
+void test_audio_queue_applies_events_on_time(void);
+void test_audio_wav_render(void);
+void test_audio_set_format(void);
 
 /* keyboard_test.c */
 void test_keyboard_checkforkeypress_returns_false_on_no_keypress(void);
 void test_keyboard_process_keydown(void);
 void test_keyboard_process_keyup(void);
 void test_keyboard_isemulatorkey(void);
+void test_keyboard_state_mask(void);
+void test_keyboard_load_keymap(void);
+void test_keyboard_load_keymap_errors(void);
 
 /**
  * Attempts to read one byte of memory at the requested address. Returns the 
@@ -378,7 +793,8 @@ memory_read(register int address)
 /*****************************************************************************/
 
 /**
- * Attempts to write one byte of information to the requested address.
+ * Attempts to write one byte of information to the requested address, and
+ * marks the page it is in as dirty.
  *
  * @param address the address in memory to write to
  * @param value the value to write to the memory location
@@ -387,12 +803,14 @@ static inline void
 memory_write(register word address, register byte value) 
 {
    memory[address.WORD] = value;
+   memory_dirty[address.BYTE.high >> 6] |= (Uint64) 1 << (address.BYTE.high & 63);
 }
 
 /*****************************************************************************/
 
 /**
- * Attempts to write one word of information to the requested address.
+ * Attempts to write one word of information to the requested address, and
+ * marks the pages both bytes are in as dirty.
  *
  * @param address the address in memory to write to
  * @param value the value to write to the memory locations
@@ -400,8 +818,12 @@ memory_write(register word address, register byte value)
 static inline void 
 memory_write_word(register word address, register word value) 
 {
+   register word next;
+   next.WORD = address.WORD + 1;
    memory[address.WORD] = value.BYTE.high;
    memory[address.WORD + 1] = value.BYTE.low;
+   memory_dirty[address.BYTE.high >> 6] |= (Uint64) 1 << (address.BYTE.high & 63);
+   memory_dirty[next.BYTE.high >> 6] |= (Uint64) 1 << (next.BYTE.high & 63);
 }
 
 #endif
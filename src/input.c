@@ -0,0 +1,102 @@
+/**
+ * Copyright (C) 2025 Craig Thomas
+ * This project uses an MIT style license - see the LICENSE file for details.
+ *
+ * @file      input.c
+ * @brief     Routines for passing input events to the CPU
+ * @author    Craig Thomas
+ *
+ * Input events are collected by the main thread (which owns the window) and
+ * need to be handed over to the CPU thread. This is done with a single
+ * producer, single consumer ring buffer. The main thread is the only writer
+ * of `input_tail`, and the CPU thread is the only writer of `input_head`, so
+ * no locks are needed on either side.
+ */
+
+/* I N C L U D E S ************************************************************/
+
+#include "globals.h"
+
+/* L O C A L S ****************************************************************/
+
+/*!
+ * The ring buffer of pending input events
+ */
+static chip8input input_queue[INPUT_QUEUE_SIZE];
+
+/*!
+ * The next slot to read from, only advanced by the consumer
+ */
+static SDL_atomic_t input_head;
+
+/*!
+ * The next slot to write to, only advanced by the producer
+ */
+static SDL_atomic_t input_tail;
+
+/* F U N C T I O N S **********************************************************/
+
+/**
+ * Discards any pending input events.
+ */
+void
+input_init(void)
+{
+    SDL_AtomicSet(&input_head, 0);
+    SDL_AtomicSet(&input_tail, 0);
+}
+
+/******************************************************************************/
+
+/**
+ * Adds an input event to the queue. Must only be called from the producer.
+ * Returns FALSE if the queue is full and the event was dropped. Key presses
+ * and quit requests also wake the CPU thread, in case it is sleeping while
+ * waiting for a key.
+ *
+ * @param type the type of the event (one of the INPUT_ defines)
+ * @param key the key associated with the event
+ * @returns TRUE if the event was queued, FALSE otherwise
+ */
+int
+input_push(int type, SDL_Keycode key)
+{
+    int tail = SDL_AtomicGet(&input_tail);
+    if (tail - SDL_AtomicGet(&input_head) >= INPUT_QUEUE_SIZE) {
+        return FALSE;
+    }
+
+    chip8input *slot = &input_queue[tail & (INPUT_QUEUE_SIZE - 1)];
+    slot->type = type;
+    slot->key = key;
+    slot->time = SDL_GetPerformanceCounter();
+    SDL_AtomicSet(&input_tail, tail + 1);
+    if (type != INPUT_KEYUP && cpu_tick != NULL) {
+        SDL_SemPost(cpu_tick);
+    }
+    return TRUE;
+}
+
+/******************************************************************************/
+
+/**
+ * Removes the oldest input event from the queue. Must only be called from the
+ * consumer. Returns FALSE if there are no pending events.
+ *
+ * @param input where to store the event
+ * @returns TRUE if an event was removed, FALSE otherwise
+ */
+int
+input_pop(chip8input *input)
+{
+    int head = SDL_AtomicGet(&input_head);
+    if (head == SDL_AtomicGet(&input_tail)) {
+        return FALSE;
+    }
+
+    *input = input_queue[head & (INPUT_QUEUE_SIZE - 1)];
+    SDL_AtomicSet(&input_head, head + 1);
+    return TRUE;
+}
+
+/* E N D   O F   F I L E ******************************************************/
@@ -0,0 +1,68 @@
+/**
+ * Copyright (C) 2025 Craig Thomas
+ * This project uses an MIT style license - see the LICENSE file for details.
+ *
+ * @file      input_test.c
+ * @brief     Tests for the input queue functions
+ * @author    Craig Thomas
+ */
+
+/* I N C L U D E S ************************************************************/
+
+#include <CUnit/CUnit.h>
+#include "globals.h"
+
+/* F U N C T I O N S **********************************************************/
+
+void
+test_input_push_pop_in_order(void)
+{
+    chip8input input;
+
+    input_init();
+    CU_ASSERT_TRUE(input_push(INPUT_KEYDOWN, SDLK_x));
+    CU_ASSERT_TRUE(input_push(INPUT_KEYUP, SDLK_x));
+    CU_ASSERT_TRUE(input_pop(&input));
+    CU_ASSERT_EQUAL(INPUT_KEYDOWN, input.type);
+    CU_ASSERT_EQUAL(SDLK_x, input.key);
+    CU_ASSERT_TRUE(input_pop(&input));
+    CU_ASSERT_EQUAL(INPUT_KEYUP, input.type);
+    CU_ASSERT_FALSE(input_pop(&input));
+}
+
+void
+test_input_push_full_queue(void)
+{
+    chip8input input;
+
+    input_init();
+    for (int x = 0; x < INPUT_QUEUE_SIZE; x++) {
+        CU_ASSERT_TRUE(input_push(INPUT_KEYDOWN, SDLK_1));
+    }
+    CU_ASSERT_FALSE(input_push(INPUT_KEYDOWN, SDLK_2));
+    CU_ASSERT_TRUE(input_pop(&input));
+    CU_ASSERT_TRUE(input_push(INPUT_KEYDOWN, SDLK_2));
+    input_init();
+}
+
+void
+test_input_push_wakes_cpu(void)
+{
+    SDL_sem *saved_cpu_tick = cpu_tick;
+
+    // Only key presses wake a CPU sleeping in FX0A, releases do not
+    cpu_tick = SDL_CreateSemaphore(0);
+    input_init();
+    CU_ASSERT_TRUE(input_push(INPUT_KEYUP, SDLK_1));
+    CU_ASSERT_EQUAL(0, SDL_SemValue(cpu_tick));
+    CU_ASSERT_TRUE(input_push(INPUT_KEYDOWN, SDLK_1));
+    CU_ASSERT_EQUAL(1, SDL_SemValue(cpu_tick));
+    CU_ASSERT_TRUE(input_push(INPUT_QUIT, SDLK_UNKNOWN));
+    CU_ASSERT_EQUAL(2, SDL_SemValue(cpu_tick));
+
+    SDL_DestroySemaphore(cpu_tick);
+    cpu_tick = saved_cpu_tick;
+    input_init();
+}
+
+/* E N D   O F   F I L E ******************************************************/
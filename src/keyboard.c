@@ -14,68 +14,95 @@
  * want to expose direct SDL_KeyCode values to the CPU, there are a number of 
  * routines that convert the SDL_KeyCode values to their associated hex values. 
  *
- * The `keyboard_def` variable controls the mapping between the emulator keys
- * 0-9 and a-f to their associated SDL_KeyCode values. Change the mapping below if
- * you want to change the emulator keyboard.
+ * SDL key codes are turned into emulator keys with a lookup table, indexed by
+ * the key code for the printable keys (0 - 127), and by the scancode for the
+ * rest (arrows, function keys, keypad). Each entry holds the emulator key
+ * plus one, or 0 if the host key is not mapped, so every key event costs a
+ * single table lookup. The state of the 16 emulator keys is kept as a bit
+ * mask, so testing a key is a single bit test, and the whole keypad can be
+ * saved or compared as one value.
+ *
+ * The default mapping is in `keyboard_default_lookup` below. A different
+ * layout can be loaded from a keymap file with `keyboard_load_keymap`.
  */
 
 /* I N C L U D E S ************************************************************/
 
-#include <malloc.h>
-
-#ifndef GLOBALS_H_
+#include <ctype.h>
+#include <stdlib.h>
 #include "globals.h"
-#endif
+
+/* D E F I N E S **************************************************************/
+
+#define KEYBOARD_PRINTABLE   128  /**< Key codes looked up directly           */
+#define KEYBOARD_LOOKUP_SIZE (KEYBOARD_PRINTABLE + SDL_NUM_SCANCODES) /**< Lookup table size */
 
 /* L O C A L S ****************************************************************/
 
 /*!
- * Keyboard mapping from SDL keys to key values 
+ * Default keyboard mapping from SDL keys to emulator keys (plus one)
  */
-SDL_KeyCode keyboard_def[] = 
+static const byte keyboard_default_lookup[KEYBOARD_LOOKUP_SIZE] =
 {
-    SDLK_x,
-    SDLK_1,
-    SDLK_2,
-    SDLK_3,
-    SDLK_q,
-    SDLK_w,
-    SDLK_e,
-    SDLK_a,
-    SDLK_s,
-    SDLK_d,
-    SDLK_z,
-    SDLK_c,
-    SDLK_4,
-    SDLK_r,
-    SDLK_f,
-    SDLK_v
+    [SDLK_x] = 0x0 + 1,
+    [SDLK_1] = 0x1 + 1,
+    [SDLK_2] = 0x2 + 1,
+    [SDLK_3] = 0x3 + 1,
+    [SDLK_q] = 0x4 + 1,
+    [SDLK_w] = 0x5 + 1,
+    [SDLK_e] = 0x6 + 1,
+    [SDLK_a] = 0x7 + 1,
+    [SDLK_s] = 0x8 + 1,
+    [SDLK_d] = 0x9 + 1,
+    [SDLK_z] = 0xA + 1,
+    [SDLK_c] = 0xB + 1,
+    [SDLK_4] = 0xC + 1,
+    [SDLK_r] = 0xD + 1,
+    [SDLK_f] = 0xE + 1,
+    [SDLK_v] = 0xF + 1
 };
 
 /*!
- * The state of the pressed keys on the keyboard
+ * A mapping loaded from a keymap file
  */
-int keyboard_state[] = {
-    FALSE, 
-    FALSE, 
-    FALSE, 
-    FALSE, 
-    FALSE, 
-    FALSE, 
-    FALSE, 
-    FALSE, 
-    FALSE, 
-    FALSE, 
-    FALSE, 
-    FALSE, 
-    FALSE, 
-    FALSE, 
-    FALSE, 
-    FALSE
-};
+static byte keyboard_custom_lookup[KEYBOARD_LOOKUP_SIZE];
+
+/*!
+ * The mapping in use
+ */
+static const byte *keyboard_lookup = keyboard_default_lookup;
+
+/*!
+ * The state of the pressed keys on the keyboard, one bit per key
+ */
+static Uint16 keyboard_state;
 
 /* F U N C T I O N S **********************************************************/
 
+/**
+ * Returns the slot of an SDL key in the lookup table, or -1 if the key cannot
+ * be mapped.
+ *
+ * @param key the SDL key
+ * @returns the slot of the key, or -1
+ */
+static int
+keyboard_slot(SDL_Keycode key)
+{
+    if (key >= 0 && key < KEYBOARD_PRINTABLE) {
+        return key;
+    }
+    if (key & SDLK_SCANCODE_MASK) {
+        int scancode = key & ~SDLK_SCANCODE_MASK;
+        if (scancode >= 0 && scancode < SDL_NUM_SCANCODES) {
+            return KEYBOARD_PRINTABLE + scancode;
+        }
+    }
+    return -1;
+}
+
+/******************************************************************************/
+
 /**
  * Checks to see whether or not the specified keycode was pressed. Returns 
  * TRUE if the key was pressed, FALSE otherwise.
@@ -87,7 +114,7 @@ int
 keyboard_checkforkeypress(int keycode)
 {
     if (keycode >= 0 && keycode < KEY_NUMBEROFKEYS) {
-        return keyboard_state[keycode];
+        return (keyboard_state >> keycode) & 1;
     }
     return FALSE;
 }
@@ -104,12 +131,8 @@ keyboard_checkforkeypress(int keycode)
 int
 keyboard_isemulatorkey(SDL_KeyCode key)
 {
-    for (int x=0; x < KEY_NUMBEROFKEYS; x++) {
-        if (key == keyboard_def[x]) {
-            return x;
-        }
-    }
-    return -1;
+    int slot = keyboard_slot(key);
+    return (slot < 0) ? -1 : keyboard_lookup[slot] - 1;
 }
 
 /******************************************************************************/
@@ -123,10 +146,9 @@ keyboard_isemulatorkey(SDL_KeyCode key)
 void
 keyboard_processkeydown(SDL_KeyCode key) 
 {
-    for (int x=0; x < KEY_NUMBEROFKEYS; x++) {
-        if (key == keyboard_def[x]) {
-            keyboard_state[x] = TRUE;
-        }
+    int emulatorkey = keyboard_isemulatorkey(key);
+    if (emulatorkey != -1) {
+        keyboard_state |= 1 << emulatorkey;
     }
 }
 
@@ -141,11 +163,115 @@ keyboard_processkeydown(SDL_KeyCode key)
 void
 keyboard_processkeyup(SDL_KeyCode key) 
 {
-    for (int x=0; x < KEY_NUMBEROFKEYS; x++) {
-        if (key == keyboard_def[x]) {
-            keyboard_state[x] = FALSE;
+    int emulatorkey = keyboard_isemulatorkey(key);
+    if (emulatorkey != -1) {
+        keyboard_state &= ~(1 << emulatorkey);
+    }
+}
+
+/******************************************************************************/
+
+/**
+ * Returns the state of all the emulator keys, one bit per key (bit 0 is key
+ * 0). Set bits are pressed keys.
+ *
+ * @returns the key state mask
+ */
+Uint16
+keyboard_get_state(void)
+{
+    return keyboard_state;
+}
+
+/******************************************************************************/
+
+/**
+ * Replaces the state of all the emulator keys.
+ *
+ * @param state the key state mask (bit 0 is key 0)
+ */
+void
+keyboard_set_state(Uint16 state)
+{
+    keyboard_state = state;
+}
+
+/******************************************************************************/
+
+/**
+ * Goes back to the default keyboard mapping.
+ */
+void
+keyboard_use_default_keymap(void)
+{
+    keyboard_lookup = keyboard_default_lookup;
+}
+
+/******************************************************************************/
+
+/**
+ * Loads a keyboard mapping from a file. Each line holds an emulator key (a
+ * hex digit) followed by the name of the SDL key to map to it, such as
+ * `5 Up` or `a space`. Several SDL keys can be mapped to the same emulator
+ * key. Blank lines and lines starting with `#` are ignored. Only the keys in
+ * the file are mapped. Returns FALSE and keeps the current mapping if the
+ * file cannot be read or has errors.
+ *
+ * @param filename the name of the keymap file
+ * @returns TRUE if the keymap was loaded, FALSE otherwise
+ */
+int
+keyboard_load_keymap(const char *filename)
+{
+    char line[MAXSTRSIZE];
+    char name[MAXSTRSIZE];
+    byte lookup[KEYBOARD_LOOKUP_SIZE];
+    int line_number = 0;
+    int emulatorkey;
+
+    FILE *fp = fopen(filename, "r");
+    if (fp == NULL) {
+        printf("Error: could not open keymap file: %s\n", filename);
+        return FALSE;
+    }
+
+    memset(lookup, 0, sizeof(lookup));
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        line_number++;
+        char *start = line;
+        while (isspace((unsigned char) *start)) {
+            start++;
+        }
+        if (*start == '\0' || *start == '#') {
+            continue;
+        }
+
+        // The key name is the rest of the line, so names can contain spaces
+        int consumed = 0;
+        if (sscanf(start, "%x %n", &emulatorkey, &consumed) != 1 || consumed == 0 ||
+                emulatorkey < 0 || emulatorkey >= KEY_NUMBEROFKEYS) {
+            printf("Error: %s:%d: expected an emulator key from 0 to F\n", filename, line_number);
+            fclose(fp);
+            return FALSE;
         }
+        strcpy(name, start + consumed);
+        for (int x = strlen(name) - 1; x >= 0 && isspace((unsigned char) name[x]); x--) {
+            name[x] = '\0';
+        }
+
+        int slot = keyboard_slot(SDL_GetKeyFromName(name));
+        if (name[0] == '\0' || slot <= 0) {
+            printf("Error: %s:%d: unknown key name: %s\n", filename, line_number, name);
+            fclose(fp);
+            return FALSE;
+        }
+        lookup[slot] = emulatorkey + 1;
     }
+    fclose(fp);
+
+    memcpy(keyboard_custom_lookup, lookup, sizeof(lookup));
+    keyboard_lookup = keyboard_custom_lookup;
+    return TRUE;
 }
 
 /* E N D   O F   F I L E ******************************************************/
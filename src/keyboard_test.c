@@ -132,4 +132,67 @@ test_keyboard_isemulatorkey(void)
     CU_ASSERT_EQUAL(1, keyboard_isemulatorkey(SDLK_1));
 }
 
+void
+test_keyboard_state_mask(void)
+{
+    keyboard_set_state(0);
+    keyboard_processkeydown(SDLK_1);
+    keyboard_processkeydown(SDLK_v);
+    keyboard_processkeydown(SDLK_k);
+    CU_ASSERT_EQUAL(0x8002, keyboard_get_state());
+    keyboard_processkeyup(SDLK_1);
+    CU_ASSERT_EQUAL(0x8000, keyboard_get_state());
+    CU_ASSERT_FALSE(keyboard_checkforkeypress(0x10));
+    keyboard_set_state(0x0005);
+    CU_ASSERT_TRUE(keyboard_checkforkeypress(0x0));
+    CU_ASSERT_FALSE(keyboard_checkforkeypress(0x1));
+    CU_ASSERT_TRUE(keyboard_checkforkeypress(0x2));
+    keyboard_set_state(0);
+}
+
+void
+test_keyboard_load_keymap(void)
+{
+    FILE *fp = fopen("test_keymap.txt", "w");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(fp);
+    fprintf(fp, "# Arrow keys and space\n\n");
+    fprintf(fp, "5 Up\n8 Down\n  7 Left\n9 Right\n6 Space\n6 k\n");
+    fclose(fp);
+
+    CU_ASSERT_TRUE(keyboard_load_keymap("test_keymap.txt"));
+    remove("test_keymap.txt");
+    CU_ASSERT_EQUAL(0x5, keyboard_isemulatorkey(SDLK_UP));
+    CU_ASSERT_EQUAL(0x8, keyboard_isemulatorkey(SDLK_DOWN));
+    CU_ASSERT_EQUAL(0x7, keyboard_isemulatorkey(SDLK_LEFT));
+    CU_ASSERT_EQUAL(0x9, keyboard_isemulatorkey(SDLK_RIGHT));
+    CU_ASSERT_EQUAL(0x6, keyboard_isemulatorkey(SDLK_SPACE));
+    CU_ASSERT_EQUAL(0x6, keyboard_isemulatorkey(SDLK_k));
+    CU_ASSERT_EQUAL(-1, keyboard_isemulatorkey(SDLK_1));
+
+    keyboard_use_default_keymap();
+    CU_ASSERT_EQUAL(-1, keyboard_isemulatorkey(SDLK_UP));
+    CU_ASSERT_EQUAL(1, keyboard_isemulatorkey(SDLK_1));
+}
+
+void
+test_keyboard_load_keymap_errors(void)
+{
+    FILE *fp = fopen("test_keymap.txt", "w");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(fp);
+    fprintf(fp, "5 Up\n10 Down\n");
+    fclose(fp);
+    CU_ASSERT_FALSE(keyboard_load_keymap("test_keymap.txt"));
+
+    fp = fopen("test_keymap.txt", "w");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(fp);
+    fprintf(fp, "5 NoSuchKey\n");
+    fclose(fp);
+    CU_ASSERT_FALSE(keyboard_load_keymap("test_keymap.txt"));
+    remove("test_keymap.txt");
+
+    // The mapping is left alone when a keymap fails to load
+    CU_ASSERT_EQUAL(1, keyboard_isemulatorkey(SDLK_1));
+    CU_ASSERT_FALSE(keyboard_load_keymap("no_such_keymap.txt"));
+}
+
 /* E N D   O F   F I L E *****************************************************/
\ No newline at end of file
@@ -0,0 +1,238 @@
+/**
+ * Copyright (C) 2025 Craig Thomas
+ * This project uses an MIT style license - see the LICENSE file for details.
+ *
+ * @file      latency.c
+ * @brief     Routines for measuring input to photon latency
+ * @author    Craig Thomas
+ *
+ * Every key event is stamped when the main thread queues it for the CPU
+ * (see input_push). When the CPU takes it off the queue, it hands a sample
+ * to the presenter through a single producer, single consumer ring buffer.
+ * Each frame is stamped when the CPU publishes it, and once the presenter
+ * has shown the first frame published after the event was handled, the
+ * sample is complete. The time is split into three stages:
+ *
+ *  - queue: waiting in the input queue for the CPU to look at it
+ *  - emulate: from the CPU handling the event until the frame is published
+ *  - present: from the frame being published until it has been presented
+ *
+ * Each stage (and the total) is counted in a histogram with buckets of
+ * LATENCY_BUCKET_US microseconds, from which percentiles are reported.
+ */
+
+/* I N C L U D E S ************************************************************/
+
+#include "globals.h"
+
+/* L O C A L S ****************************************************************/
+
+/*!
+ * The samples waiting for their frame to be presented
+ */
+static chip8latencysample latency_queue[LATENCY_QUEUE_SIZE];
+
+/*!
+ * The next slot to read from, only advanced by the presenter
+ */
+static SDL_atomic_t latency_head;
+
+/*!
+ * The next slot to write to, only advanced by the CPU thread
+ */
+static SDL_atomic_t latency_tail;
+
+/*!
+ * Set when the statistics should be printed after the next present
+ */
+static SDL_atomic_t latency_print_requested;
+
+/*!
+ * The histograms for each stage, and the number of samples dropped because
+ * the queue was full
+ */
+static Uint32 latency_histogram[LATENCY_STAGES][LATENCY_BUCKETS];
+static Uint32 latency_count;
+static Uint32 latency_dropped;
+
+/*!
+ * The names of each stage, in the order of the LATENCY_ defines
+ */
+static const char *latency_stage_names[LATENCY_STAGES] = {
+    "queue", "emulate", "present", "total"
+};
+
+/* F U N C T I O N S **********************************************************/
+
+/**
+ * Clears all of the statistics and any samples still waiting.
+ */
+void
+latency_reset(void)
+{
+    memset(latency_histogram, 0, sizeof(latency_histogram));
+    latency_count = 0;
+    latency_dropped = 0;
+    SDL_AtomicSet(&latency_head, 0);
+    SDL_AtomicSet(&latency_tail, 0);
+    SDL_AtomicSet(&latency_print_requested, 0);
+}
+
+/******************************************************************************/
+
+/**
+ * Records that the CPU has handled an input event. Must only be called from
+ * the CPU thread. Does nothing unless latency statistics are turned on.
+ *
+ * @param input the input event that was handled
+ */
+void
+latency_input(const chip8input *input)
+{
+    if (!latency_stats) {
+        return;
+    }
+
+    int tail = SDL_AtomicGet(&latency_tail);
+    if (tail - SDL_AtomicGet(&latency_head) >= LATENCY_QUEUE_SIZE) {
+        latency_dropped++;
+        return;
+    }
+
+    chip8latencysample *sample = &latency_queue[tail & (LATENCY_QUEUE_SIZE - 1)];
+    sample->pushed = input->time;
+    sample->popped = SDL_GetPerformanceCounter();
+    SDL_AtomicSet(&latency_tail, tail + 1);
+}
+
+/******************************************************************************/
+
+/**
+ * Adds a time to the histogram for a stage. Times below zero are counted as
+ * zero.
+ *
+ * @param stage the stage (one of the LATENCY_ defines)
+ * @param ticks the time taken, in performance counter ticks
+ */
+static void
+latency_add(int stage, Sint64 ticks)
+{
+    if (ticks < 0) {
+        ticks = 0;
+    }
+    Uint64 bucket = ticks * 1000000 / SDL_GetPerformanceFrequency() / LATENCY_BUCKET_US;
+    latency_histogram[stage][bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1]++;
+}
+
+/******************************************************************************/
+
+/**
+ * Records that a frame has been presented, completing every sample for an
+ * event that was handled before the frame was published. Must only be called
+ * from the presenter thread, right after the frame is presented. Does nothing
+ * unless latency statistics are turned on.
+ *
+ * @param frame the frame that was presented
+ */
+void
+latency_present(const chip8frame *frame)
+{
+    if (!latency_stats) {
+        return;
+    }
+
+    Uint64 presented = SDL_GetPerformanceCounter();
+    int head = SDL_AtomicGet(&latency_head);
+    while (head != SDL_AtomicGet(&latency_tail)) {
+        chip8latencysample *sample = &latency_queue[head & (LATENCY_QUEUE_SIZE - 1)];
+        if (sample->popped > frame->published) {
+            break;
+        }
+        latency_add(LATENCY_QUEUE, (Sint64) (sample->popped - sample->pushed));
+        latency_add(LATENCY_EMULATE, (Sint64) (frame->published - sample->popped));
+        latency_add(LATENCY_PRESENT, (Sint64) (presented - frame->published));
+        latency_add(LATENCY_TOTAL, (Sint64) (presented - sample->pushed));
+        latency_count++;
+        head++;
+    }
+    SDL_AtomicSet(&latency_head, head);
+
+    if (SDL_AtomicSet(&latency_print_requested, 0)) {
+        latency_print_stats();
+    }
+}
+
+/******************************************************************************/
+
+/**
+ * Asks the presenter to print the statistics after the next frame it shows.
+ * Safe to call from any thread.
+ */
+void
+latency_request_print(void)
+{
+    SDL_AtomicSet(&latency_print_requested, 1);
+}
+
+/******************************************************************************/
+
+/**
+ * Returns the given percentile of a stage, in microseconds. The result is
+ * the upper edge of the histogram bucket the percentile falls in, or 0 if
+ * there are no samples.
+ *
+ * @param stage the stage (one of the LATENCY_ defines)
+ * @param percent the percentile to return, from 1 to 100
+ * @returns the percentile in microseconds
+ */
+Uint32
+latency_percentile(int stage, int percent)
+{
+    if (latency_count == 0) {
+        return 0;
+    }
+
+    Uint64 wanted = ((Uint64) latency_count * percent + 99) / 100;
+    Uint64 seen = 0;
+    int bucket;
+    for (bucket = 0; bucket < LATENCY_BUCKETS - 1; bucket++) {
+        seen += latency_histogram[stage][bucket];
+        if (seen >= wanted) {
+            break;
+        }
+    }
+    return (bucket + 1) * LATENCY_BUCKET_US;
+}
+
+/******************************************************************************/
+
+/**
+ * Returns the number of samples recorded so far.
+ *
+ * @returns the number of completed samples
+ */
+Uint32
+latency_samples(void)
+{
+    return latency_count;
+}
+
+/******************************************************************************/
+
+/**
+ * Prints the p50, p95 and p99 latency of each stage.
+ */
+void
+latency_print_stats(void)
+{
+    printf("Input latency over %u key events (%u dropped):\n", latency_count, latency_dropped);
+    for (int stage = 0; stage < LATENCY_STAGES; stage++) {
+        printf("  %-8s p50 %6.1f ms  p95 %6.1f ms  p99 %6.1f ms\n",
+               latency_stage_names[stage],
+               latency_percentile(stage, 50) / 1000.0,
+               latency_percentile(stage, 95) / 1000.0,
+               latency_percentile(stage, 99) / 1000.0);
+    }
+}
+
+/* E N D   O F   F I L E ******************************************************/
@@ -0,0 +1,78 @@
+/**
+ * Copyright (C) 2025 Craig Thomas
+ * This project uses an MIT style license - see the LICENSE file for details.
+ *
+ * @file      latency_test.c
+ * @brief     Tests for the input latency statistics
+ * @author    Craig Thomas
+ */
+
+/* I N C L U D E S ************************************************************/
+
+#include <CUnit/CUnit.h>
+#include "globals.h"
+
+/* F U N C T I O N S **********************************************************/
+
+void
+test_latency_stages(void)
+{
+    Uint64 millisecond = SDL_GetPerformanceFrequency() / 1000;
+    chip8input input;
+    chip8frame frame;
+
+    // An event queued 5 ms ago, shown in a frame published 3 ms after it was
+    // handled, which counts as presented immediately
+    latency_stats = TRUE;
+    latency_reset();
+    input.type = INPUT_KEYDOWN;
+    input.key = SDLK_1;
+    input.time = SDL_GetPerformanceCounter() - 5 * millisecond;
+    latency_input(&input);
+    frame.published = SDL_GetPerformanceCounter() + 3 * millisecond;
+    latency_present(&frame);
+
+    CU_ASSERT_EQUAL(1, latency_samples());
+    CU_ASSERT_TRUE(latency_percentile(LATENCY_QUEUE, 50) > 5000);
+    CU_ASSERT_TRUE(latency_percentile(LATENCY_QUEUE, 50) <= 5500);
+    CU_ASSERT_TRUE(latency_percentile(LATENCY_EMULATE, 99) > 2500);
+    CU_ASSERT_TRUE(latency_percentile(LATENCY_EMULATE, 99) <= 3100);
+    CU_ASSERT_EQUAL(LATENCY_BUCKET_US, latency_percentile(LATENCY_PRESENT, 95));
+    CU_ASSERT_TRUE(latency_percentile(LATENCY_TOTAL, 50) > 5000);
+    CU_ASSERT_TRUE(latency_percentile(LATENCY_TOTAL, 50) <= 5500);
+
+    latency_stats = FALSE;
+    latency_reset();
+}
+
+void
+test_latency_waits_for_later_frame(void)
+{
+    chip8input input;
+    chip8frame frame;
+
+    // A frame published before the event was handled cannot show it
+    latency_stats = TRUE;
+    latency_reset();
+    frame.published = SDL_GetPerformanceCounter();
+    input.type = INPUT_KEYDOWN;
+    input.key = SDLK_1;
+    input.time = frame.published;
+    latency_input(&input);
+    latency_present(&frame);
+    CU_ASSERT_EQUAL(0, latency_samples());
+    CU_ASSERT_EQUAL(0, latency_percentile(LATENCY_TOTAL, 50));
+
+    frame.published = SDL_GetPerformanceCounter();
+    latency_present(&frame);
+    CU_ASSERT_EQUAL(1, latency_samples());
+
+    // Nothing is recorded while the statistics are turned off
+    latency_stats = FALSE;
+    latency_input(&input);
+    latency_present(&frame);
+    CU_ASSERT_EQUAL(1, latency_samples());
+    latency_reset();
+}
+
+/* E N D   O F   F I L E ******************************************************/
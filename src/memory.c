@@ -15,17 +15,51 @@
  * restriction, it is still good practice (for example, the Color Computer 3
  * has memory mapped I/O, which is another open project). When the memory for
  * the emulator is no longer needed, it may be freed using `memory_destroy`.
+ *
+ * Instructions such as `FX65` and `DXY0` read from `I` plus an offset, which
+ * can run past the end of memory, and the skip instructions look back from
+ * `PC`, which can run past the start. Rather than checking every access,
+ * memory is mapped with a mirror on either side of it:
+ *
+ *     | guard | last page | memory ... | first page | guard |
+ *
+ * The page after memory is the first page of memory mapped a second time,
+ * and the page before it is the last page, so an access up to a page past
+ * either end wraps around just as a 16-bit address would. Anything further
+ * out lands on a guard page with no access allowed, and faults rather than
+ * touching some other part of the emulator.
+ *
+ * Every write through `memory_write` or `memory_write_word` also sets the bit
+ * for its 256 byte page in `memory_dirty`. The bits show which pages have
+ * changed since the last checkpoint, so a checkpoint can be taken or rolled
+ * back by copying only those pages (see `memory_copy_dirty`). Anything that
+ * changes memory without going through the write routines must call
+ * `memory_mark_all_dirty`.
  */
 
 /* I N C L U D E S ***********************************************************/
 
-#include <malloc.h>
+#define _GNU_SOURCE
+#include <errno.h>
+#include <sys/mman.h>
+#include <unistd.h>
 #include "globals.h"
 
+/* L O C A L S ***************************************************************/
+
+/*!
+ * The whole mapping that memory sits in (guard pages and mirrors included),
+ * and its size
+ */
+static byte *memory_mapping;
+static size_t memory_mapping_size;
+
 /* F U N C T I O N S *********************************************************/
 
 /**
- * Attempts to malloc a memory block to use as emulator memory. Returns TRUE on
+ * Maps a memory block to use as emulator memory, with a mirror and a guard
+ * page on either side. The size must be a multiple of the host page size.
+ * Memory starts out filled with zeros, with every page dirty. Returns TRUE on
  * success or FALSE on failure.
  *
  * @param memorysize the size of memory to allocate for the emulator
@@ -33,15 +67,45 @@
 int 
 memory_init(int memorysize) 
 {
-   if (memory != NULL) {
-      free(memory);
-      memory = NULL;
+   size_t page = sysconf(_SC_PAGESIZE);
+   memory_destroy();
+   if (memorysize <= 0 || memorysize % page != 0) {
+      printf("Error: memory size must be a multiple of %zu bytes\n", page);
+      return FALSE;
+   }
+
+   int fd = memfd_create("yac8e-memory", MFD_CLOEXEC);
+   if (fd < 0 || ftruncate(fd, memorysize) != 0) {
+      printf("Error: could not create emulator memory: %s\n", strerror(errno));
+      if (fd >= 0) {
+         close(fd);
+      }
+      return FALSE;
    }
-   memory = (byte *)malloc(sizeof (byte) * memorysize);
-   if (memory != NULL) {
-      memset(memory, 0, memorysize);
+
+   // Reserve the whole range with no access, then map memory and its mirrors
+   // over the middle of it, leaving a guard page at each end
+   memory_mapping_size = memorysize + 4 * page;
+   memory_mapping = mmap(NULL, memory_mapping_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+   int mapped = memory_mapping != MAP_FAILED;
+   byte *start = mapped ? memory_mapping + 2 * page : NULL;
+   mapped = mapped &&
+      mmap(start - page, page, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, memorysize - page) != MAP_FAILED &&
+      mmap(start, memorysize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED &&
+      mmap(start + memorysize, page, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED;
+   close(fd);
+
+   if (!mapped) {
+      printf("Error: could not map emulator memory: %s\n", strerror(errno));
+      if (memory_mapping != MAP_FAILED) {
+         munmap(memory_mapping, memory_mapping_size);
+      }
+      memory_mapping = NULL;
+      return FALSE;
    }
-   return memory != NULL;
+   memory = start;
+   memory_mark_all_dirty();
+   return TRUE;
 }
 
 /*****************************************************************************/
@@ -52,8 +116,63 @@ memory_init(int memorysize)
 void 
 memory_destroy(void) 
 {
-   free(memory);
+   if (memory_mapping != NULL) {
+      munmap(memory_mapping, memory_mapping_size);
+   }
+   memory_mapping = NULL;
    memory = NULL;
 }
 
+/*****************************************************************************/
+
+/**
+ * Marks every page of memory as dirty, for when memory is changed without
+ * going through the write routines (such as when it is first mapped).
+ */
+void
+memory_mark_all_dirty(void)
+{
+   memset(memory_dirty, 0xFF, sizeof(memory_dirty));
+}
+
+/*****************************************************************************/
+
+/**
+ * Marks every page of memory as clean. Called once a checkpoint holds the
+ * same contents as memory.
+ */
+void
+memory_clear_dirty(void)
+{
+   memset(memory_dirty, 0, sizeof(memory_dirty));
+}
+
+/*****************************************************************************/
+
+/**
+ * Copies each dirty page from one memory image to another. Used to bring a
+ * checkpoint up to date with memory, or to roll memory back to a checkpoint,
+ * when the two only differ in the dirty pages. The dirty bits are left as
+ * they are.
+ *
+ * @param target the memory image to copy to
+ * @param source the memory image to copy from
+ * @returns the number of pages copied
+ */
+int
+memory_copy_dirty(byte *target, const byte *source)
+{
+   int copied = 0;
+   for (int index = 0; index < MEM_PAGES / 64; index++) {
+      Uint64 bits = memory_dirty[index];
+      while (bits != 0) {
+         int offset = (index * 64 + __builtin_ctzll(bits)) * MEM_PAGE_SIZE;
+         memcpy(target + offset, source + offset, MEM_PAGE_SIZE);
+         bits &= bits - 1;
+         copied++;
+      }
+   }
+   return copied;
+}
+
 /* E N D   O F   F I L E *****************************************************/
@@ -0,0 +1,293 @@
+/**
+ * Copyright (C) 2025 Craig Thomas
+ * This project uses an MIT style license - see the LICENSE file for details.
+ *
+ * @file      realtime.c
+ * @brief     Routines for running with low frame time jitter
+ * @author    Craig Thomas
+ *
+ * Realtime mode pins the emulation threads to chosen cores and runs them
+ * with the SCHED_FIFO policy, so that nothing else on the machine gets in
+ * the way of a frame. All memory is locked with mlockall so that a frame
+ * never waits on a page fault, and the memory the threads use is touched up
+ * front so that it is already mapped in. Each of these needs privileges that
+ * the emulator may not have (such as CAP_SYS_NICE, or a high enough
+ * RLIMIT_MEMLOCK). Anything that cannot be done is reported once, and the
+ * emulator carries on without it.
+ *
+ * The time between the start of each frame is also tracked, so that the
+ * jitter that was actually achieved can be reported.
+ */
+
+/* I N C L U D E S ************************************************************/
+
+#define _GNU_SOURCE
+#include <ctype.h>
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <time.h>
+#include "globals.h"
+
+/* D E F I N E S **************************************************************/
+
+#define REALTIME_STACK_PREFAULT 65536 /**< Stack bytes touched per thread     */
+#define REALTIME_PAGE_SIZE      4096  /**< Stride used when touching memory   */
+#define REALTIME_BUCKETS        1000  /**< Jitter buckets, the last is overflow */
+#define REALTIME_BUCKET_NS      10000 /**< Width of each jitter bucket (in ns)  */
+
+/* L O C A L S ****************************************************************/
+
+/*!
+ * Whether realtime mode is on, and the cores the CPU and audio threads are
+ * pinned to
+ */
+static int realtime_enabled;
+static int realtime_cpu_core;
+static int realtime_audio_core;
+
+/*!
+ * The SCHED_FIFO priority of each kind of thread, above the lowest priority
+ */
+static const int realtime_priorities[REALTIME_THREADS] = { 10, 30, 20 };
+
+/*!
+ * The names of each kind of thread, in the order of the REALTIME_ defines
+ */
+static const char *realtime_thread_names[REALTIME_THREADS] = { "cpu", "timer", "audio" };
+
+/*!
+ * Set once a thread could not be pinned, or could not get realtime priority,
+ * so that each problem is only reported once
+ */
+static SDL_atomic_t realtime_pin_failed;
+static SDL_atomic_t realtime_priority_failed;
+
+/*!
+ * The time the last frame started, and the statistics of the time between
+ * frames (in nanoseconds)
+ */
+static Uint64 realtime_last_frame;
+static Uint32 realtime_frames;
+static double realtime_total;
+static double realtime_total_squares;
+static Uint64 realtime_shortest;
+static Uint64 realtime_longest;
+static Uint32 realtime_jitter[REALTIME_BUCKETS];
+
+/* F U N C T I O N S **********************************************************/
+
+/**
+ * Touches every page of a block of memory, so that it is mapped in before it
+ * is needed.
+ *
+ * @param block the start of the memory
+ * @param length the length of the memory (in bytes)
+ */
+void
+realtime_prefault(void *block, size_t length)
+{
+    volatile byte *bytes = block;
+    for (size_t offset = 0; offset < length; offset += REALTIME_PAGE_SIZE) {
+        bytes[offset] = bytes[offset];
+    }
+    if (length > 0) {
+        bytes[length - 1] = bytes[length - 1];
+    }
+}
+
+/******************************************************************************/
+
+/**
+ * Turns on realtime mode. The cores are given as `CPU` or `CPU,AUDIO`, where
+ * CPU is the core for the CPU and timer threads, and AUDIO is the core for the
+ * audio thread (the same as CPU if it is left out). Locks all current and
+ * future memory, and touches the screen. Must be called before any of the
+ * emulator threads start. Returns FALSE only if the cores cannot be parsed.
+ *
+ * @param cores the list of cores to pin to
+ * @returns TRUE on success, FALSE otherwise
+ */
+int
+realtime_init(const char *cores)
+{
+    char *end;
+
+    int valid = isdigit((unsigned char) cores[0]);
+    realtime_cpu_core = strtol(cores, &end, 10);
+    realtime_audio_core = realtime_cpu_core;
+    if (valid && *end == ',') {
+        valid = isdigit((unsigned char) end[1]);
+        realtime_audio_core = strtol(end + 1, &end, 10);
+    }
+    if (!valid || *end != '\0') {
+        printf("Error: expected realtime cores as CPU or CPU,AUDIO: %s\n", cores);
+        return FALSE;
+    }
+
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        printf("Warning: could not lock memory (%s), page faults may cause jitter\n", strerror(errno));
+    }
+    realtime_prefault(&display, sizeof(display));
+    realtime_enabled = TRUE;
+    return TRUE;
+}
+
+/******************************************************************************/
+
+/**
+ * Pins the calling thread to its core, runs it with the SCHED_FIFO policy,
+ * and touches the top of its stack. Called by each thread as it starts. Does
+ * nothing unless realtime mode is on.
+ *
+ * @param thread the kind of thread calling (one of the REALTIME_ defines)
+ */
+void
+realtime_enter_thread(int thread)
+{
+    volatile byte stack[REALTIME_STACK_PREFAULT];
+    cpu_set_t cpuset;
+    struct sched_param param;
+
+    if (!realtime_enabled) {
+        return;
+    }
+
+    CPU_ZERO(&cpuset);
+    CPU_SET(thread == REALTIME_AUDIO ? realtime_audio_core : realtime_cpu_core, &cpuset);
+    int result = pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+    if (result != 0 && SDL_AtomicSet(&realtime_pin_failed, 1) == 0) {
+        printf("Warning: could not pin the %s thread to a core (%s)\n", realtime_thread_names[thread], strerror(result));
+    }
+
+    param.sched_priority = sched_get_priority_min(SCHED_FIFO) + realtime_priorities[thread];
+    result = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (result != 0 && SDL_AtomicSet(&realtime_priority_failed, 1) == 0) {
+        printf("Warning: could not run the %s thread with realtime priority (%s)\n", realtime_thread_names[thread], strerror(result));
+    }
+
+    realtime_prefault((void *) stack, sizeof(stack));
+}
+
+/******************************************************************************/
+
+/**
+ * Records that a frame has started. Must only be called from the CPU thread.
+ * Does nothing unless jitter statistics are turned on.
+ */
+void
+realtime_frame_mark(void)
+{
+    struct timespec now;
+
+    if (!jitter_stats) {
+        return;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    Uint64 time = (Uint64) now.tv_sec * 1000000000ULL + now.tv_nsec;
+    if (realtime_last_frame != 0) {
+        realtime_add_frame(time - realtime_last_frame);
+    }
+    realtime_last_frame = time;
+}
+
+/******************************************************************************/
+
+/**
+ * Adds the time between two frames to the statistics.
+ *
+ * @param length the time between the frames (in nanoseconds)
+ */
+void
+realtime_add_frame(Uint64 length)
+{
+    Sint64 jitter = (Sint64) length - 1000000000LL / SCREEN_VERTREFRESH;
+    Uint64 bucket = (jitter < 0 ? -jitter : jitter) / REALTIME_BUCKET_NS;
+
+    if (realtime_frames == 0 || length < realtime_shortest) {
+        realtime_shortest = length;
+    }
+    if (length > realtime_longest) {
+        realtime_longest = length;
+    }
+    realtime_frames++;
+    realtime_total += length;
+    realtime_total_squares += (double) length * length;
+    realtime_jitter[bucket < REALTIME_BUCKETS ? bucket : REALTIME_BUCKETS - 1]++;
+}
+
+/******************************************************************************/
+
+/**
+ * Returns a percentile of the difference between the frame time and a perfect
+ * 60 Hz frame, in nanoseconds. The percentile is given in tenths of a
+ * percent, so 990 is the 99th percentile. The result is the upper edge of the
+ * bucket the percentile falls in, or 0 if there are no frames.
+ *
+ * @param permille the percentile to return, from 1 to 1000
+ * @returns the percentile in nanoseconds
+ */
+Uint64
+realtime_jitter_percentile(int permille)
+{
+    if (realtime_frames == 0) {
+        return 0;
+    }
+
+    Uint64 wanted = ((Uint64) realtime_frames * permille + 999) / 1000;
+    Uint64 seen = 0;
+    int bucket;
+    for (bucket = 0; bucket < REALTIME_BUCKETS - 1; bucket++) {
+        seen += realtime_jitter[bucket];
+        if (seen >= wanted) {
+            break;
+        }
+    }
+    return (Uint64) (bucket + 1) * REALTIME_BUCKET_NS;
+}
+
+/******************************************************************************/
+
+/**
+ * Clears the frame time statistics.
+ */
+void
+realtime_reset_stats(void)
+{
+    realtime_last_frame = 0;
+    realtime_frames = 0;
+    realtime_total = 0;
+    realtime_total_squares = 0;
+    realtime_shortest = 0;
+    realtime_longest = 0;
+    memset(realtime_jitter, 0, sizeof(realtime_jitter));
+}
+
+/******************************************************************************/
+
+/**
+ * Prints the frame time statistics: the average, standard deviation, shortest
+ * and longest frame, and the 50th, 99th and 99.9th percentile of how far
+ * frames were from a perfect 60 Hz.
+ */
+void
+realtime_print_stats(void)
+{
+    double mean = realtime_frames ? realtime_total / realtime_frames : 0;
+    double variance = realtime_frames ? realtime_total_squares / realtime_frames - mean * mean : 0;
+
+    printf("Frame times over %u frames:\n", realtime_frames);
+    printf("  average %.3f ms, deviation %.3f ms, shortest %.3f ms, longest %.3f ms\n",
+           mean / 1000000.0, sqrt(variance > 0 ? variance : 0) / 1000000.0,
+           realtime_shortest / 1000000.0, realtime_longest / 1000000.0);
+    printf("  jitter p50 %.2f ms, p99 %.2f ms, p99.9 %.2f ms\n",
+           realtime_jitter_percentile(500) / 1000000.0,
+           realtime_jitter_percentile(990) / 1000000.0,
+           realtime_jitter_percentile(999) / 1000000.0);
+}
+
+/* E N D   O F   F I L E ******************************************************/
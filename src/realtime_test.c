@@ -0,0 +1,55 @@
+/**
+ * Copyright (C) 2025 Craig Thomas
+ * This project uses an MIT style license - see the LICENSE file for details.
+ *
+ * @file      realtime_test.c
+ * @brief     Tests for the realtime mode functions
+ * @author    Craig Thomas
+ */
+
+/* I N C L U D E S ************************************************************/
+
+#include <CUnit/CUnit.h>
+#include "globals.h"
+
+/* F U N C T I O N S **********************************************************/
+
+void
+test_realtime_jitter_stats(void)
+{
+    realtime_reset_stats();
+    CU_ASSERT_EQUAL(0, realtime_jitter_percentile(500));
+
+    // 98 perfect frames, one 100 us late and one 2 ms early
+    for (int frame = 0; frame < 98; frame++) {
+        realtime_add_frame(16666667);
+    }
+    realtime_add_frame(16766667);
+    realtime_add_frame(14666667);
+
+    CU_ASSERT_EQUAL(10000, realtime_jitter_percentile(500));
+    CU_ASSERT_EQUAL(10000, realtime_jitter_percentile(980));
+    CU_ASSERT_EQUAL(110000, realtime_jitter_percentile(990));
+    CU_ASSERT_EQUAL(2000000, realtime_jitter_percentile(1000));
+
+    // Anything past the last bucket lands in the overflow bucket
+    realtime_reset_stats();
+    realtime_add_frame(1000000000);
+    CU_ASSERT_EQUAL(10000000, realtime_jitter_percentile(500));
+    realtime_reset_stats();
+}
+
+void
+test_realtime_init_rejects_bad_cores(void)
+{
+    CU_ASSERT_FALSE(realtime_init(""));
+    CU_ASSERT_FALSE(realtime_init("abc"));
+    CU_ASSERT_FALSE(realtime_init("1,"));
+    CU_ASSERT_FALSE(realtime_init("-1"));
+    CU_ASSERT_FALSE(realtime_init("0,1,2"));
+
+    // Without realtime mode, threads are left alone
+    realtime_enter_thread(REALTIME_CPU);
+}
+
+/* E N D   O F   F I L E ******************************************************/
@@ -0,0 +1,857 @@
+/**
+ * Copyright (C) 2025 Craig Thomas
+ * This project uses an MIT style license - see the LICENSE file for details.
+ *
+ * @file      record.c
+ * @brief     Routines for recording video and taking screenshots
+ * @author    Craig Thomas
+ *
+ * Frames are recorded at the native 128 x 64 resolution, either as raw Y4M
+ * (4:4:4, full range) or as an animated GIF. Screenshots are written as PNG
+ * files. All of the encoding happens on a background thread. The CPU thread
+ * only copies the packed bitplanes into a preallocated single producer,
+ * single consumer queue, and then posts a semaphore to wake the encoder.
+ *
+ * Frames that are identical to the previous frame (according to screen_hash)
+ * are never queued. Instead, each queued frame carries its frame number, and
+ * the encoder works out how long the previous frame was on the screen. For
+ * Y4M, the previous frame is written again for each frame that was elided.
+ * For GIF, the elided frames simply extend the delay of the previous frame.
+ */
+
+/* I N C L U D E S ************************************************************/
+
+#include <time.h>
+#include "globals.h"
+
+/* D E F I N E S **************************************************************/
+
+#define RECORD_FORMAT_NONE 0     /**< Not recording, screenshots only         */
+#define RECORD_FORMAT_Y4M  1     /**< Recording to raw Y4M                    */
+#define RECORD_FORMAT_GIF  2     /**< Recording to animated GIF               */
+
+#define RECORD_PIXELS (SCREEN_WIDTH * SCREEN_HEIGHT) /**< Pixels in a frame   */
+
+#define GIF_MIN_CODE_SIZE 2      /**< LZW minimum code size for 4 colors      */
+#define GIF_CLEAR_CODE    4      /**< LZW code that resets the dictionary     */
+#define GIF_END_CODE      5      /**< LZW code that ends the image data       */
+#define GIF_MAX_CODE      4095   /**< Largest LZW code allowed                */
+#define GIF_MIN_DELAY     2      /**< Smallest delay (in 1/100ths of a second)*/
+
+/* L O C A L S ****************************************************************/
+
+/*!
+ * The queue of captures waiting to be encoded
+ */
+static chip8capture record_queue[RECORD_QUEUE_SIZE];
+
+/*!
+ * The next slot to read from, only advanced by the encoder thread
+ */
+static SDL_atomic_t record_head;
+
+/*!
+ * The next slot to write to, only advanced by the producer
+ */
+static SDL_atomic_t record_tail;
+
+/*!
+ * Posted once for every capture added to the queue
+ */
+static SDL_sem *record_ready;
+
+/*!
+ * The encoder thread
+ */
+static SDL_Thread *record_thread;
+
+/*!
+ * The file being recorded to, and its format
+ */
+static FILE *record_file;
+static int record_format;
+
+/*!
+ * Producer side state - the number of frames seen, the hash of the last frame
+ * queued, and the number of captures dropped because the queue was full
+ */
+static Uint32 record_frame_count;
+static Uint64 record_last_hash;
+static int record_have_frame;
+static Uint32 record_dropped;
+
+/*!
+ * Encoder side state - the number of distinct frames encoded, and the frame
+ * number of the last one
+ */
+static Uint32 record_encoded;
+static Uint32 record_last_number;
+
+/*!
+ * The color index of every pixel in the capture being encoded
+ */
+static byte record_indices[RECORD_PIXELS];
+
+/*!
+ * The Y, U and V planes of the last frame written to a Y4M file
+ */
+static byte record_yuv[3][RECORD_PIXELS];
+
+/*!
+ * The YUV values of the four bitplane colors
+ */
+static byte record_yuv_palette[4][3];
+
+/*!
+ * The frame waiting to be written to a GIF file (its length is only known
+ * once the next frame arrives), and the time at which it starts
+ */
+static byte gif_pending[RECORD_PIXELS];
+static Uint32 gif_written_cs;
+
+/*!
+ * The LZW dictionary, stored as a trie - gif_codes[code][pixel] is the code
+ * for the string `code` followed by `pixel`, or 0 if there is none
+ */
+static Uint16 gif_codes[GIF_MAX_CODE + 1][4];
+
+/*!
+ * Bits waiting to be written into a GIF data sub-block
+ */
+static Uint32 gif_bit_buffer;
+static int gif_bit_count;
+static byte gif_block[255];
+static int gif_block_length;
+
+/*!
+ * Lookup table for the CRC32 used by PNG chunks
+ */
+static Uint32 png_crc_table[256];
+
+/* F U N C T I O N S **********************************************************/
+
+/**
+ * Converts the packed bitplanes into one color index (0 - 3) per pixel.
+ *
+ * @param source the display to convert
+ * @param indices where to store the 128 x 64 color indices
+ */
+void
+record_convert_indices(const chip8display *source, byte *indices)
+{
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        for (int x = 0; x < SCREEN_ROW_BYTES; x++) {
+            byte bits_1 = source->plane[0][y][x];
+            byte bits_2 = source->plane[1][y][x];
+            for (int bit = 7; bit >= 0; bit--) {
+                *indices++ = ((bits_1 >> bit) & 1) | (((bits_2 >> bit) & 1) << 1);
+            }
+        }
+    }
+}
+
+/******************************************************************************/
+
+/**
+ * Returns one of the red, green or blue components of a bitplane color.
+ *
+ * @param color the bitplane color to look up (0 - 3)
+ * @param shift 16 for red, 8 for green or 0 for blue
+ * @returns the color component
+ */
+static byte
+record_component(int color, int shift)
+{
+    return (byte) ((get_bitplane_color(color) >> shift) & 0xFF);
+}
+
+/******************************************************************************/
+
+/**
+ * Writes a big-endian 32-bit value to a buffer.
+ *
+ * @param buffer where to write the value
+ * @param value the value to write
+ */
+static void
+record_put_be32(byte *buffer, Uint32 value)
+{
+    buffer[0] = (byte) (value >> 24);
+    buffer[1] = (byte) (value >> 16);
+    buffer[2] = (byte) (value >> 8);
+    buffer[3] = (byte) value;
+}
+
+/******************************************************************************/
+
+/**
+ * Adds a capture to the queue if there is room for it. Returns FALSE if the
+ * queue is full, without counting the capture as dropped.
+ *
+ * @param type the type of capture (one of the CAPTURE_ defines)
+ * @param number the frame number of the capture
+ * @returns TRUE if the capture was queued, FALSE otherwise
+ */
+static int
+record_try_push(int type, Uint32 number)
+{
+    int tail = SDL_AtomicGet(&record_tail);
+    if (tail - SDL_AtomicGet(&record_head) >= RECORD_QUEUE_SIZE) {
+        return FALSE;
+    }
+
+    chip8capture *slot = &record_queue[tail & (RECORD_QUEUE_SIZE - 1)];
+    slot->type = type;
+    slot->number = number;
+    if (type != CAPTURE_END) {
+        memcpy(&slot->display, &display, sizeof(chip8display));
+    }
+    SDL_AtomicSet(&record_tail, tail + 1);
+    SDL_SemPost(record_ready);
+    return TRUE;
+}
+
+/******************************************************************************/
+
+/**
+ * Adds a capture to the queue. Returns FALSE if the queue is full and the
+ * capture was dropped.
+ *
+ * @param type the type of capture (one of the CAPTURE_ defines)
+ * @param number the frame number of the capture
+ * @returns TRUE if the capture was queued, FALSE otherwise
+ */
+static int
+record_push(int type, Uint32 number)
+{
+    if (!record_try_push(type, number)) {
+        record_dropped++;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/******************************************************************************/
+
+/**
+ * Writes a single Y4M frame from the Y, U and V planes of the last frame.
+ *
+ * @param fp the file to write to
+ */
+static void
+record_y4m_write_frame(FILE *fp)
+{
+    fputs("FRAME\n", fp);
+    fwrite(record_yuv, 1, sizeof(record_yuv), fp);
+}
+
+/******************************************************************************/
+
+/**
+ * Writes the Y4M stream header, and works out the YUV values of the bitplane
+ * colors (BT.601, full range).
+ *
+ * @param fp the file to write to
+ */
+static void
+record_y4m_start(FILE *fp)
+{
+    for (int color = 0; color < 4; color++) {
+        int r = record_component(color, 16);
+        int g = record_component(color, 8);
+        int b = record_component(color, 0);
+        int y = (19595 * r + 38470 * g + 7471 * b + 32768) >> 16;
+        int u = ((-11059 * r - 21709 * g + 32768 * b + 32768) >> 16) + 128;
+        int v = ((32768 * r - 27439 * g - 5329 * b + 32768) >> 16) + 128;
+        record_yuv_palette[color][0] = (byte) y;
+        record_yuv_palette[color][1] = (byte) (u < 0 ? 0 : (u > 255 ? 255 : u));
+        record_yuv_palette[color][2] = (byte) (v < 0 ? 0 : (v > 255 ? 255 : v));
+    }
+    fprintf(fp, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444 XCOLORRANGE=FULL\n",
+            SCREEN_WIDTH, SCREEN_HEIGHT, SCREEN_VERTREFRESH);
+}
+
+/******************************************************************************/
+
+/**
+ * Writes a frame to the Y4M file. Since Y4M has a fixed frame rate, the
+ * previous frame is first repeated once for every frame that was elided.
+ *
+ * @param fp the file to write to
+ * @param capture the frame to write
+ */
+static void
+record_y4m_frame(FILE *fp, const chip8capture *capture)
+{
+    if (record_encoded > 0) {
+        for (Uint32 n = record_last_number + 1; n < capture->number; n++) {
+            record_y4m_write_frame(fp);
+        }
+    }
+
+    record_convert_indices(&capture->display, record_indices);
+    for (int pixel = 0; pixel < RECORD_PIXELS; pixel++) {
+        const byte *yuv = record_yuv_palette[record_indices[pixel]];
+        record_yuv[0][pixel] = yuv[0];
+        record_yuv[1][pixel] = yuv[1];
+        record_yuv[2][pixel] = yuv[2];
+    }
+    record_y4m_write_frame(fp);
+}
+
+/******************************************************************************/
+
+/**
+ * Finishes the Y4M file by repeating the last frame until the end of the
+ * recording.
+ *
+ * @param fp the file to write to
+ * @param number the number of the first frame after the recording
+ */
+static void
+record_y4m_finish(FILE *fp, Uint32 number)
+{
+    if (record_encoded > 0) {
+        for (Uint32 n = record_last_number + 1; n < number; n++) {
+            record_y4m_write_frame(fp);
+        }
+    }
+}
+
+/******************************************************************************/
+
+/**
+ * Writes the GIF header, the global color table holding the four bitplane
+ * colors, and the extension that makes the animation loop forever.
+ *
+ * @param fp the file to write to
+ */
+static void
+record_gif_start(FILE *fp)
+{
+    byte header[13] = {
+        'G', 'I', 'F', '8', '9', 'a',
+        SCREEN_WIDTH & 0xFF, SCREEN_WIDTH >> 8,
+        SCREEN_HEIGHT & 0xFF, SCREEN_HEIGHT >> 8,
+        0xF1,   // Global color table, 8 bits per channel, 4 entries
+        0,
+        0
+    };
+    fwrite(header, 1, sizeof(header), fp);
+
+    for (int color = 0; color < 4; color++) {
+        fputc(record_component(color, 16), fp);
+        fputc(record_component(color, 8), fp);
+        fputc(record_component(color, 0), fp);
+    }
+
+    byte loop[19] = {
+        0x21, 0xFF, 11, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0',
+        3, 1, 0, 0, 0
+    };
+    fwrite(loop, 1, sizeof(loop), fp);
+    gif_written_cs = 0;
+}
+
+/******************************************************************************/
+
+/**
+ * Adds a code to the GIF data, writing out data sub-blocks as they fill up.
+ *
+ * @param fp the file to write to
+ * @param code the code to add
+ * @param code_size the number of bits in the code
+ */
+static void
+record_gif_put_code(FILE *fp, int code, int code_size)
+{
+    gif_bit_buffer |= (Uint32) code << gif_bit_count;
+    gif_bit_count += code_size;
+
+    while (gif_bit_count >= 8) {
+        gif_block[gif_block_length++] = (byte) (gif_bit_buffer & 0xFF);
+        gif_bit_buffer >>= 8;
+        gif_bit_count -= 8;
+        if (gif_block_length == sizeof(gif_block)) {
+            fputc(gif_block_length, fp);
+            fwrite(gif_block, 1, gif_block_length, fp);
+            gif_block_length = 0;
+        }
+    }
+}
+
+/******************************************************************************/
+
+/**
+ * Compresses a frame of color indices with LZW, and writes it out as GIF
+ * image data.
+ *
+ * @param fp the file to write to
+ * @param indices the color index of each pixel
+ */
+void
+record_gif_write_lzw(FILE *fp, const byte *indices)
+{
+    int code_size = GIF_MIN_CODE_SIZE + 1;
+    int max_code = GIF_END_CODE;
+    int current = indices[0];
+
+    memset(gif_codes, 0, sizeof(gif_codes));
+    gif_bit_buffer = 0;
+    gif_bit_count = 0;
+    gif_block_length = 0;
+
+    fputc(GIF_MIN_CODE_SIZE, fp);
+    record_gif_put_code(fp, GIF_CLEAR_CODE, code_size);
+
+    for (int pixel = 1; pixel < RECORD_PIXELS; pixel++) {
+        int next = indices[pixel];
+        if (gif_codes[current][next]) {
+            current = gif_codes[current][next];
+            continue;
+        }
+
+        record_gif_put_code(fp, current, code_size);
+        gif_codes[current][next] = ++max_code;
+        if (max_code >= (1 << code_size)) {
+            code_size++;
+        }
+        if (max_code == GIF_MAX_CODE) {
+            record_gif_put_code(fp, GIF_CLEAR_CODE, code_size);
+            memset(gif_codes, 0, sizeof(gif_codes));
+            code_size = GIF_MIN_CODE_SIZE + 1;
+            max_code = GIF_END_CODE;
+        }
+        current = next;
+    }
+
+    record_gif_put_code(fp, current, code_size);
+    record_gif_put_code(fp, GIF_END_CODE, code_size);
+    if (gif_bit_count > 0) {
+        record_gif_put_code(fp, 0, 8 - gif_bit_count);
+    }
+    if (gif_block_length > 0) {
+        fputc(gif_block_length, fp);
+        fwrite(gif_block, 1, gif_block_length, fp);
+    }
+    fputc(0, fp);
+}
+
+/******************************************************************************/
+
+/**
+ * Writes the pending GIF frame, which stays on the screen for the specified
+ * number of hundredths of a second.
+ *
+ * @param fp the file to write to
+ * @param delay how long the frame is shown for, in 1/100ths of a second
+ */
+static void
+record_gif_write_pending(FILE *fp, int delay)
+{
+    byte control[8] = { 0x21, 0xF9, 4, 0x04, delay & 0xFF, delay >> 8, 0, 0 };
+    fwrite(control, 1, sizeof(control), fp);
+
+    byte descriptor[10] = {
+        0x2C, 0, 0, 0, 0,
+        SCREEN_WIDTH & 0xFF, SCREEN_WIDTH >> 8,
+        SCREEN_HEIGHT & 0xFF, SCREEN_HEIGHT >> 8,
+        0
+    };
+    fwrite(descriptor, 1, sizeof(descriptor), fp);
+    record_gif_write_lzw(fp, gif_pending);
+    gif_written_cs += delay;
+}
+
+/******************************************************************************/
+
+/**
+ * Returns the time at which a frame starts, in 1/100ths of a second.
+ *
+ * @param number the frame number
+ * @returns the start time of the frame
+ */
+static Uint32
+record_gif_time(Uint32 number)
+{
+    return (Uint32) (((Uint64) number * 100) / SCREEN_VERTREFRESH);
+}
+
+/******************************************************************************/
+
+/**
+ * Adds a frame to the GIF file. The previous frame is written out now that
+ * its length is known. Since GIF delays are in 1/100ths of a second, and
+ * viewers do not respect very short delays, a frame that would be shown for
+ * less than GIF_MIN_DELAY is replaced by the frame that follows it.
+ *
+ * @param fp the file to write to
+ * @param capture the frame to add
+ */
+static void
+record_gif_frame(FILE *fp, const chip8capture *capture)
+{
+    if (record_encoded > 0) {
+        Uint32 delay = record_gif_time(capture->number) - gif_written_cs;
+        if (delay >= GIF_MIN_DELAY) {
+            record_gif_write_pending(fp, delay);
+        }
+    }
+    record_convert_indices(&capture->display, gif_pending);
+}
+
+/******************************************************************************/
+
+/**
+ * Finishes the GIF file by writing out the last frame and the trailer.
+ *
+ * @param fp the file to write to
+ * @param number the number of the first frame after the recording
+ */
+static void
+record_gif_finish(FILE *fp, Uint32 number)
+{
+    if (record_encoded > 0) {
+        Uint32 end = record_gif_time(number);
+        Uint32 delay = end > gif_written_cs ? end - gif_written_cs : 0;
+        record_gif_write_pending(fp, delay < GIF_MIN_DELAY ? GIF_MIN_DELAY : delay);
+    }
+    fputc(0x3B, fp);
+}
+
+/******************************************************************************/
+
+/**
+ * Computes the CRC32 used by PNG chunks over a buffer.
+ *
+ * @param crc the CRC of the data so far
+ * @param data the data to add
+ * @param length the number of bytes to add
+ * @returns the updated CRC
+ */
+static Uint32
+record_png_crc(Uint32 crc, const byte *data, size_t length)
+{
+    if (png_crc_table[1] == 0) {
+        for (Uint32 n = 0; n < 256; n++) {
+            Uint32 c = n;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+            }
+            png_crc_table[n] = c;
+        }
+    }
+
+    crc = ~crc;
+    for (size_t n = 0; n < length; n++) {
+        crc = png_crc_table[(crc ^ data[n]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+/******************************************************************************/
+
+/**
+ * Writes a single PNG chunk, along with its length and CRC.
+ *
+ * @param fp the file to write to
+ * @param type the four character chunk type
+ * @param data the contents of the chunk
+ * @param length the length of the contents
+ */
+static void
+record_png_chunk(FILE *fp, const char *type, const byte *data, Uint32 length)
+{
+    byte buffer[4];
+
+    record_put_be32(buffer, length);
+    fwrite(buffer, 1, 4, fp);
+    fwrite(type, 1, 4, fp);
+    fwrite(data, 1, length, fp);
+
+    Uint32 crc = record_png_crc(0, (const byte *) type, 4);
+    crc = record_png_crc(crc, data, length);
+    record_put_be32(buffer, crc);
+    fwrite(buffer, 1, 4, fp);
+}
+
+/******************************************************************************/
+
+/**
+ * Writes a display to a file as an RGB PNG image at the native resolution.
+ * The image data is small enough to fit in a single stored (uncompressed)
+ * deflate block, so no compressor is needed.
+ *
+ * @param fp the file to write to
+ * @param source the display to write
+ */
+void
+record_write_png(FILE *fp, const chip8display *source)
+{
+    static const byte signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    enum { ROW_LENGTH = 1 + SCREEN_WIDTH * 3, RAW_LENGTH = ROW_LENGTH * SCREEN_HEIGHT };
+    static byte idat[2 + 5 + RAW_LENGTH + 4];
+    byte header[13];
+
+    fwrite(signature, 1, sizeof(signature), fp);
+
+    record_put_be32(&header[0], SCREEN_WIDTH);
+    record_put_be32(&header[4], SCREEN_HEIGHT);
+    header[8] = 8;      // Bit depth
+    header[9] = 2;      // Truecolor
+    header[10] = 0;     // Deflate
+    header[11] = 0;     // Adaptive filtering
+    header[12] = 0;     // No interlacing
+    record_png_chunk(fp, "IHDR", header, sizeof(header));
+
+    byte *raw = &idat[7];
+    record_convert_indices(source, record_indices);
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        byte *row = &raw[y * ROW_LENGTH];
+        *row++ = 0;     // No filter
+        for (int x = 0; x < SCREEN_WIDTH; x++) {
+            int color = record_indices[y * SCREEN_WIDTH + x];
+            *row++ = record_component(color, 16);
+            *row++ = record_component(color, 8);
+            *row++ = record_component(color, 0);
+        }
+    }
+
+    Uint32 a = 1, b = 0;
+    for (int n = 0; n < RAW_LENGTH; n++) {
+        a = (a + raw[n]) % 65521;
+        b = (b + a) % 65521;
+    }
+
+    idat[0] = 0x78;
+    idat[1] = 0x01;
+    idat[2] = 0x01;     // Final stored block
+    idat[3] = RAW_LENGTH & 0xFF;
+    idat[4] = RAW_LENGTH >> 8;
+    idat[5] = (0xFFFF - RAW_LENGTH) & 0xFF;
+    idat[6] = (0xFFFF - RAW_LENGTH) >> 8;
+    record_put_be32(&raw[RAW_LENGTH], (b << 16) | a);
+    record_png_chunk(fp, "IDAT", idat, sizeof(idat));
+    record_png_chunk(fp, "IEND", NULL, 0);
+}
+
+/******************************************************************************/
+
+/**
+ * Writes a screenshot to a new PNG file in the current directory.
+ *
+ * @param capture the screenshot to write
+ */
+static void
+record_write_screenshot(const chip8capture *capture)
+{
+    char filename[64];
+    snprintf(filename, sizeof(filename), "yac8e-%ld-%u.png", (long) time(NULL), capture->number);
+
+    FILE *fp = fopen(filename, "wb");
+    if (fp == NULL) {
+        printf("Error: could not write screenshot: %s\n", filename);
+        return;
+    }
+    record_write_png(fp, &capture->display);
+    fclose(fp);
+    printf("Saved screenshot to %s\n", filename);
+}
+
+/******************************************************************************/
+
+/**
+ * The encoder thread. Waits for captures to arrive in the queue and encodes
+ * them, until the end of the recording is reached.
+ *
+ * @param data unused
+ * @returns always 0
+ */
+static int
+record_thread_main(void *data)
+{
+    chip8capture *capture;
+
+    while (TRUE) {
+        SDL_SemWait(record_ready);
+        int head = SDL_AtomicGet(&record_head);
+        capture = &record_queue[head & (RECORD_QUEUE_SIZE - 1)];
+
+        switch (capture->type) {
+            case CAPTURE_FRAME:
+                if (record_format == RECORD_FORMAT_Y4M) {
+                    record_y4m_frame(record_file, capture);
+                } else if (record_format == RECORD_FORMAT_GIF) {
+                    record_gif_frame(record_file, capture);
+                }
+                record_last_number = capture->number;
+                record_encoded++;
+                break;
+
+            case CAPTURE_SCREENSHOT:
+                record_write_screenshot(capture);
+                break;
+
+            case CAPTURE_END:
+                if (record_format == RECORD_FORMAT_Y4M) {
+                    record_y4m_finish(record_file, capture->number);
+                } else if (record_format == RECORD_FORMAT_GIF) {
+                    record_gif_finish(record_file, capture->number);
+                }
+                SDL_AtomicSet(&record_head, head + 1);
+                return 0;
+
+            default:
+                break;
+        }
+        SDL_AtomicSet(&record_head, head + 1);
+    }
+}
+
+/******************************************************************************/
+
+/**
+ * Starts the encoder thread. If a filename is given, frames are recorded to
+ * it. The format is chosen by the extension of the file (.y4m or .gif).
+ * Screenshots can be taken whether or not a recording is being made. Returns
+ * FALSE if the recording could not be started.
+ *
+ * @param filename the file to record to, or NULL to only take screenshots
+ * @returns TRUE if the encoder was started, FALSE otherwise
+ */
+int
+record_init(const char *filename)
+{
+    record_format = RECORD_FORMAT_NONE;
+    record_file = NULL;
+
+    if (filename != NULL) {
+        const char *extension = strrchr(filename, '.');
+        if (extension != NULL && strcmp(extension, ".y4m") == 0) {
+            record_format = RECORD_FORMAT_Y4M;
+        } else if (extension != NULL && strcmp(extension, ".gif") == 0) {
+            record_format = RECORD_FORMAT_GIF;
+        } else {
+            printf("Error: recordings must end in .y4m or .gif: %s\n", filename);
+            return FALSE;
+        }
+
+        record_file = fopen(filename, "wb");
+        if (record_file == NULL) {
+            printf("Error: could not open recording file: %s\n", filename);
+            return FALSE;
+        }
+
+        if (record_format == RECORD_FORMAT_Y4M) {
+            record_y4m_start(record_file);
+        } else {
+            record_gif_start(record_file);
+        }
+    }
+
+    SDL_AtomicSet(&record_head, 0);
+    SDL_AtomicSet(&record_tail, 0);
+    record_frame_count = 0;
+    record_have_frame = FALSE;
+    record_dropped = 0;
+    record_encoded = 0;
+    record_last_number = 0;
+
+    record_ready = SDL_CreateSemaphore(0);
+    record_thread = SDL_CreateThread(record_thread_main, "record", NULL);
+    if (record_ready == NULL || record_thread == NULL) {
+        printf("Error: Unable to start recording thread\n%s\n", SDL_GetError());
+        if (record_file != NULL) {
+            fclose(record_file);
+            record_file = NULL;
+        }
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/******************************************************************************/
+
+/**
+ * Captures the current display as the next frame of the recording. Frames
+ * that are identical to the last frame captured are skipped. Must be called
+ * once per frame from the CPU thread.
+ */
+void
+record_capture(void)
+{
+    if (record_format == RECORD_FORMAT_NONE) {
+        return;
+    }
+
+    Uint32 number = record_frame_count++;
+    Uint64 hash = screen_hash();
+    if (record_have_frame && hash == record_last_hash) {
+        return;
+    }
+
+    if (record_push(CAPTURE_FRAME, number)) {
+        record_last_hash = hash;
+        record_have_frame = TRUE;
+    }
+}
+
+/******************************************************************************/
+
+/**
+ * Captures the current display as a screenshot, which is written out to a
+ * PNG file by the encoder thread.
+ */
+void
+record_screenshot(void)
+{
+    if (record_thread != NULL) {
+        record_push(CAPTURE_SCREENSHOT, record_frame_count);
+    }
+}
+
+/******************************************************************************/
+
+/**
+ * Returns the number of distinct frames that have been encoded.
+ *
+ * @returns the number of frames encoded
+ */
+Uint32
+record_frames_encoded(void)
+{
+    return record_encoded;
+}
+
+/******************************************************************************/
+
+/**
+ * Finishes the recording, waits for the encoder thread to write out any
+ * pending captures, and closes the recording file.
+ */
+void
+record_destroy(void)
+{
+    if (record_thread == NULL) {
+        return;
+    }
+
+    // The end marker must not be dropped, so wait for room in the queue
+    while (!record_try_push(CAPTURE_END, record_frame_count)) {
+        SDL_Delay(1);
+    }
+    SDL_WaitThread(record_thread, NULL);
+    SDL_DestroySemaphore(record_ready);
+    record_thread = NULL;
+    record_ready = NULL;
+
+    if (record_file != NULL) {
+        fclose(record_file);
+        record_file = NULL;
+    }
+    if (record_dropped > 0) {
+        printf("Warning: %u frames were dropped from the recording\n", record_dropped);
+    }
+}
+
+/* E N D   O F   F I L E ******************************************************/
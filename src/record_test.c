@@ -0,0 +1,98 @@
+/**
+ * Copyright (C) 2025 Craig Thomas
+ * This project uses an MIT style license - see the LICENSE file for details.
+ *
+ * @file      record_test.c
+ * @brief     Tests for the recording functions
+ * @author    Craig Thomas
+ */
+
+/* I N C L U D E S ************************************************************/
+
+#include <CUnit/CUnit.h>
+#include "globals.h"
+
+/* F U N C T I O N S **********************************************************/
+
+void
+test_record_rejects_unknown_format(void)
+{
+    CU_ASSERT_FALSE(record_init("test_record.avi"));
+}
+
+void
+test_record_y4m_elides_duplicate_frames(void)
+{
+    CU_TEST_FATAL(screen_init());
+    CU_TEST_FATAL(record_init("test_record.y4m"));
+    record_capture();
+    record_capture();
+    record_capture();
+    draw_pixel(1, 1, 1, 1);
+    record_capture();
+    record_capture();
+    record_destroy();
+    CU_ASSERT_EQUAL(2, record_frames_encoded());
+
+    FILE *fp = fopen("test_record.y4m", "rb");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(fp);
+    char header[128];
+    CU_ASSERT_PTR_NOT_NULL(fgets(header, sizeof(header), fp));
+    CU_ASSERT_EQUAL(0, strncmp(header, "YUV4MPEG2 W128 H64 F60:1", 24));
+    long header_length = ftell(fp);
+    fseek(fp, 0, SEEK_END);
+    CU_ASSERT_EQUAL(header_length + 5 * (6 + 3 * SCREEN_WIDTH * SCREEN_HEIGHT), ftell(fp));
+    fclose(fp);
+    remove("test_record.y4m");
+    screen_destroy();
+}
+
+void
+test_record_gif(void)
+{
+    unsigned char buffer[6];
+
+    CU_TEST_FATAL(screen_init());
+    CU_TEST_FATAL(record_init("test_record.gif"));
+    for (int x = 0; x < 10; x++) {
+        draw_pixel(x, x, 1, 3);
+        record_capture();
+        record_capture();
+    }
+    record_destroy();
+    CU_ASSERT_EQUAL(10, record_frames_encoded());
+
+    FILE *fp = fopen("test_record.gif", "rb");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(fp);
+    CU_ASSERT_EQUAL(6, fread(buffer, 1, 6, fp));
+    CU_ASSERT_EQUAL(0, memcmp(buffer, "GIF89a", 6));
+    fseek(fp, -1, SEEK_END);
+    CU_ASSERT_EQUAL(0x3B, fgetc(fp));
+    fclose(fp);
+    remove("test_record.gif");
+    screen_destroy();
+}
+
+void
+test_record_write_png(void)
+{
+    unsigned char buffer[24];
+    unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+    CU_TEST_FATAL(screen_init());
+    FILE *fp = tmpfile();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(fp);
+    record_write_png(fp, &display);
+    CU_ASSERT_EQUAL(8 + 25 + 12 + (2 + 5 + 64 * (1 + 128 * 3) + 4) + 12, ftell(fp));
+
+    rewind(fp);
+    CU_ASSERT_EQUAL(24, fread(buffer, 1, 24, fp));
+    CU_ASSERT_EQUAL(0, memcmp(buffer, signature, 8));
+    CU_ASSERT_EQUAL(0, memcmp(&buffer[12], "IHDR", 4));
+    CU_ASSERT_EQUAL(128, buffer[19]);
+    CU_ASSERT_EQUAL(64, buffer[23]);
+    fclose(fp);
+    screen_destroy();
+}
+
+/* E N D   O F   F I L E ******************************************************/
@@ -6,11 +6,20 @@
  * @brief     Routines for addressing emulator screen
  * @author    Craig Thomas
  *
- * The emulator defines a primary SDL surface called `screen`. The surface is
- * used to draw pixels on. By default, it attempts to create a double-buffered
- * video memory based surface with 8 bits per pixel. Note that if you wish to
- * change the number of bits per pixel, you will need to update the 
- * `screen_get_pixel` function accordingly. 
+ * The emulator keeps the contents of the screen in the `display` structure,
+ * which holds the two XO Chip bitplanes at the native 128 x 64 resolution,
+ * packed 8 pixels to a byte. All of the drawing, scrolling and blanking
+ * routines operate directly on the packed bitplanes.
+ *
+ * The screen never talks to a window directly. Completed frames are handed to
+ * a video backend (see video.c), which uses screen_convert to turn the
+ * bitplanes into colors.
+ *
+ * A 64-bit hash of the display is kept up to date incrementally. Every
+ * routine that writes to the bitplanes marks the native rows it touched as
+ * dirty, and screen_hash only rehashes those rows. Each row hash depends on
+ * the row number, and the row hashes are combined with XOR, so replacing a
+ * single row hash is enough to update the combined value.
  */
 
 /* I N C L U D E S ************************************************************/
@@ -19,91 +28,50 @@
 #include <stdlib.h>
 #include "globals.h"
 
-/* F U N C T I O N S **********************************************************/
+/* D E F I N E S **************************************************************/
 
-SDL_Surface *
-create_surface(int width, int height)
-{
-    SDL_Surface *temp_surface = SDL_CreateRGBSurfaceWithFormat(
-        0, 
-        width, 
-        height, 
-        SCREEN_DEPTH,
-        SDL_PIXELFORMAT_ARGB8888
-    );
-
-    if (temp_surface == NULL) {
-        printf("Error: Unable to initialize surface:\n%s\n", SDL_GetError());
-    }
+#define SCREEN_ALL_ROWS  (~(Uint64) 0)               /**< Every native row    */
+#define SCREEN_HASH_MODE 0x9E3779B97F4A7C15ULL       /**< Mixed in per mode   */
 
-    SDL_SetSurfaceBlendMode(temp_surface, SDL_BLENDMODE_NONE);
+/* L O C A L S ****************************************************************/
 
-    return temp_surface;
-}
+/*!
+ * The hash of each native row of the display (both bitplanes)
+ */
+static Uint64 screen_row_hashes[SCREEN_HEIGHT];
 
-/******************************************************************************/
+/*!
+ * The XOR of all of the row hashes
+ */
+static Uint64 screen_rows_hash;
+
+/*!
+ * One bit per native row, set when the row has changed since it was hashed
+ */
+static Uint64 screen_dirty_rows = SCREEN_ALL_ROWS;
+
+/* F U N C T I O N S **********************************************************/
 
 /**
- * Initializes the emulator primary surface. By default, attempts to create
- * a hardware based surface that is double buffered. To update the screen, you
- * must call screen_refresh. Returns TRUE if the screen was created.
+ * Initializes the emulator screen. The display is cleared, and the bitplane
+ * colors are set up. Nothing here creates a window - presenting the display
+ * is left to the selected video backend (see video.c). Returns TRUE if the
+ * screen was initialized.
  *
- * @returns TRUE if the screen was created, FALSE otherwise
+ * @returns TRUE if the screen was initialized, FALSE otherwise
  */
 int 
 screen_init(void)
 {
+    memset(&display, 0, sizeof(display));
+    screen_mark_dirty(SCREEN_ALL_ROWS);
 
-    int width = SCREEN_WIDTH * scale_factor;
-    int height = SCREEN_HEIGHT * scale_factor;
-
-    window = SDL_CreateWindow(
-        "YAC8 Emulator",
-        SDL_WINDOWPOS_UNDEFINED,
-        SDL_WINDOWPOS_UNDEFINED,
-        width,
-        height,
-        SDL_WINDOW_OPENGL
-    );
-    
-    if (window == NULL) {
-        printf("Error: Unable to initialize window:\n%s\n", SDL_GetError());
-        return FALSE;
-    } 
-
-    renderer = SDL_CreateRenderer(
-        window, 
-        -1,
-        SDL_RENDERER_ACCELERATED 
-    );
-
-    if (renderer == NULL) {
-        printf("Error: Unable to initialize renderer:\n%s\n", SDL_GetError());
-        return FALSE;
-    }
-    
-    surface = create_surface(width, height);
-
-    if (surface == NULL) {
-        return FALSE;
-    }
-
-    texture = SDL_CreateTexture(
-        renderer,
-        SDL_PIXELFORMAT_ARGB8888,
-        SDL_TEXTUREACCESS_STREAMING,
-        width, height
-    );
-
-    if (texture == NULL) {
-        printf("Error: Unable to initialize texture:\n%s\n", SDL_GetError());
-        return FALSE;
-    }
-
-    COLOR_0 = SDL_MapRGBA(surface->format, 0,    0,    0, 0);
-    COLOR_1 = SDL_MapRGBA(surface->format, 250, 51,  204, 255);
-    COLOR_2 = SDL_MapRGBA(surface->format, 51,  204, 250, 0);
-    COLOR_3 = SDL_MapRGBA(surface->format, 250, 250, 250, 0);
+    SDL_PixelFormat *format = SDL_AllocFormat(SDL_PIXELFORMAT_ARGB8888);
+    COLOR_0 = SDL_MapRGBA(format, 0,    0,    0, 0);
+    COLOR_1 = SDL_MapRGBA(format, 250, 51,  204, 255);
+    COLOR_2 = SDL_MapRGBA(format, 51,  204, 250, 0);
+    COLOR_3 = SDL_MapRGBA(format, 250, 250, 250, 0);
+    SDL_FreeFormat(format);
 
     return TRUE;
 }
@@ -143,7 +111,8 @@ get_bitplane_color(int plane)
 /**
  * Returns whether or not the pixel at location x, y is on or off. Returns 1
  * if the pixel is turned on, 0 otherwise. Pixel coordinates are based upon the
- * unscaled size of the screen (64 x 32).
+ * unscaled size of the screen (64 x 32 in normal mode, 128 x 64 in extended
+ * mode). When the plane is 3, the pixel must be turned on in both bitplanes.
  *
  * @param x the x coordinate of the pixel to check
  * @param y the y coordinate of the pixel to check
@@ -153,23 +122,25 @@ get_bitplane_color(int plane)
 int 
 get_pixel(int x, int y, int plane)
 {
-    if (bitplane == 0) {
+    if (bitplane == 0 || plane == 0) {
         return FALSE;
     }
 
-    Uint8 r, g, b;
-    Uint32 color = 0;
-    Uint32 bitplane_color = get_bitplane_color(plane);
-    int mode_scale = screen_mode == SCREEN_MODE_EXTENDED ? 1 : 2;
+    int mode_scale = screen_get_mode_scale();
+    x = x * mode_scale;
+    y = y * mode_scale;
 
-    x = x * scale_factor * mode_scale;
-    y = y * scale_factor * mode_scale;
+    if (x < 0 || x >= SCREEN_WIDTH || y < 0 || y >= SCREEN_HEIGHT) {
+        return FALSE;
+    }
 
-    Uint32 *pixels = (Uint32 *)surface->pixels;
-    Uint32 pixel = pixels[(surface->w * y) + x];
-    SDL_GetRGB(pixel, surface->format, &r, &g, &b);
-    color = SDL_MapRGB(surface->format, r, g, b);
-    return color == bitplane_color || color == COLOR_3;
+    byte mask = 0x80 >> (x & 7);
+    for (int p = 0; p < SCREEN_PLANES; p++) {
+        if ((plane & (1 << p)) && !(display.plane[p][y][x >> 3] & mask)) {
+            return FALSE;
+        }
+    }
+    return TRUE;
 }
 
 /******************************************************************************/
@@ -188,49 +159,20 @@ screen_is_extended_mode(void)
 /******************************************************************************/
 
 /**
- * Helper routine to blit one surface onto another surface at the specified
- * location. This routine blits the entire source surface onto the destination.
- *
- * @param src the source surface to blit
- * @param dest the destination surface to blit to
- * @param x the x location on the destination to blit to
- * @param y the y location on the destination to blit to
- */
-void 
-screen_blit_surface(SDL_Surface *src, SDL_Surface *dest, int x, int y)
-{
-    SDL_Rect location;
-    location.x = x;
-    location.y = y;
-    SDL_BlitSurface(src, NULL, dest, &location);
-}
-
-/******************************************************************************/
-
-/**
- * Blanks out the virtual screen (needed for the CPU, since we want to keep the
- * CPU well separated from the SDL surfaces that are used in the screen
- * routines).
+ * Blanks out the specified bitplane (or both bitplanes if plane is 3).
  * 
  * @param plane the bitplane to blank out
  */
 void 
 screen_blank(int plane)
 {
-    if (plane == 0) {
-        return;
-    }
-
-    if (bitplane == 3) {
-        Uint32 bitplane_color = get_bitplane_color(plane);
-        screen_clear(bitplane_color);
+    if (plane & 0x3) {
+        screen_mark_dirty(SCREEN_ALL_ROWS);
     }
 
-    int max_x = screen_get_width();
-    int max_y = screen_get_height();
-    for (int x = 0; x < max_x; x++) {
-        for (int y = 0; y < max_y; y++) {
-            draw_pixel(x, y, FALSE, plane);
+    for (int p = 0; p < SCREEN_PLANES; p++) {
+        if (plane & (1 << p)) {
+            memset(display.plane[p], 0, sizeof(display.plane[p]));
         }
     }
 }
@@ -238,32 +180,21 @@ screen_blank(int plane)
 /******************************************************************************/
 
 /**
- * Clears the screen by setting all pixels to off (0).
+ * Converts the packed bitplanes into colors, and writes them to a 128 x 64
+ * ARGB8888 pixel buffer (for example, the locked pixels of a texture).
  * 
- * @param color the color to write to the surface
+ * @param source the display to convert
+ * @param pixels the pixel buffer to write to
+ * @param pitch the length of one row of the pixel buffer in bytes
  */
 void 
-screen_clear(Uint32 color)
+screen_convert(const chip8display *source, Uint32 *pixels, int pitch)
 {
-    SDL_Rect rect;
-    rect.x = 0;
-    rect.y = 0;
-    rect.w = SCREEN_WIDTH * scale_factor;
-    rect.h = SCREEN_HEIGHT * scale_factor;
-    SDL_FillRect(surface, &rect, color);
-}
-
-/******************************************************************************/
-
-/**
- * Refreshes the screen. 
- */
-void 
-screen_refresh(void)
-{
-    SDL_UpdateTexture(texture, NULL, surface->pixels, surface->pitch);
-    SDL_RenderCopy(renderer, texture, NULL, NULL);
-    SDL_RenderPresent(renderer);
+    Uint32 palette[4];
+    for (int color = 0; color < 4; color++) {
+        palette[color] = get_bitplane_color(color);
+    }
+    expand_bitplanes(source, pixels, pitch, palette, 1, 1);
 }
 
 /******************************************************************************/
@@ -271,7 +202,8 @@ screen_refresh(void)
 /**
  * Draws a pixel on the screen at coordinates x, y with the specified color.
  * The color is simply 1 (for on) or 0 (for off). The x and y coordinates are
- * based on the unscaled size of the screen (64 x 32).
+ * based on the unscaled size of the screen (64 x 32 in normal mode, 128 x 64
+ * in extended mode). Pixels in the other bitplane are left untouched.
  *
  * @param x the x coordinate of the pixel
  * @param y the y coordinate of the pixel
@@ -285,43 +217,42 @@ draw_pixel(int x, int y, int turn_on, int plane)
         return;
     }
 
-    int other_bitplane = (plane == 1) ? 2 : 1;
-    int other_pixel_on = get_pixel(x, y, other_bitplane);
-    Uint32 draw_color = get_bitplane_color(0);
-    SDL_Rect pixel;
+    int mode_scale = screen_get_mode_scale();
+    x = x * mode_scale;
+    y = y * mode_scale;
 
-    if (turn_on && other_pixel_on) {
-        draw_color = get_bitplane_color(3);
+    if (x < 0 || x >= SCREEN_WIDTH || y < 0 || y >= SCREEN_HEIGHT) {
+        return;
     }
 
-    if (turn_on && !other_pixel_on) {
-        draw_color = get_bitplane_color(plane);
-    }
+    screen_mark_dirty(((Uint64) (mode_scale == 1 ? 0x1 : 0x3)) << y);
 
-    if (!turn_on && other_pixel_on) {
-        draw_color = get_bitplane_color(other_bitplane);
+    // In normal mode, a logical pixel covers a 2 x 2 block of native pixels
+    byte mask = (mode_scale == 1 ? 0x80 : 0xC0) >> (x & 7);
+    for (int p = 0; p < SCREEN_PLANES; p++) {
+        if (!(plane & (1 << p))) {
+            continue;
+        }
+        for (int row = y; row < y + mode_scale; row++) {
+            if (turn_on) {
+                display.plane[p][row][x >> 3] |= mask;
+            } else {
+                display.plane[p][row][x >> 3] &= ~mask;
+            }
+        }
     }
-
-    int mode_scale = screen_get_mode_scale();
-    pixel.x = x * scale_factor * mode_scale;
-    pixel.y = y * scale_factor * mode_scale;
-    pixel.w = scale_factor * mode_scale;
-    pixel.h = scale_factor * mode_scale;
-    SDL_FillRect(surface, &pixel, draw_color);
 }
 
 /******************************************************************************/
 
 /**
- * Destroys all the surfaces used by the screen.
+ * Destroys all the structures used by the screen.
  */
 void
 screen_destroy(void)
 {
-    SDL_FreeSurface(surface);
-    SDL_DestroyRenderer(renderer);
-    SDL_DestroyTexture(texture);
-    SDL_DestroyWindow(window);
+    memset(&display, 0, sizeof(display));
+    screen_mark_dirty(SCREEN_ALL_ROWS);
 }
 
 /******************************************************************************/
@@ -349,64 +280,70 @@ screen_set_normal_mode(void)
 /******************************************************************************/
 
 /**
- * Scrolls the screen left by 4 pixels.
- * 
- * @param plane the bitplane to scroll
+ * Shifts a single packed row of the display to the left by the specified
+ * number of native pixels. Pixels shifted in from the right are turned off.
+ *
+ * @param row the packed row to shift
+ * @param num_pixels the number of native pixels to shift by
  */
 void
-screen_scroll_left(int plane) 
+screen_shift_row_left(byte *row, int num_pixels)
 {
-    if (plane == 0) {
-        return;
-    }
-
-    int mode_scale = screen_get_mode_scale();
-    int width = screen_get_width() * scale_factor * mode_scale;
-    int height = screen_get_height() * scale_factor * mode_scale;
-
-    int max_x = screen_get_width();
-    int max_y = screen_get_height();
-    if (plane == 3) {    
-        SDL_Rect source_rect, dest_rect;
+    int byte_shift = num_pixels / 8;
+    int bit_shift = num_pixels % 8;
 
-        SDL_Surface *temp_surface = create_surface(width, height);
+    for (int x = 0; x < SCREEN_ROW_BYTES; x++) {
+        int source = x + byte_shift;
+        byte high = (source < SCREEN_ROW_BYTES) ? row[source] : 0;
+        byte low = (source + 1 < SCREEN_ROW_BYTES) ? row[source + 1] : 0;
+        row[x] = bit_shift ? (byte) ((high << bit_shift) | (low >> (8 - bit_shift))) : high;
+    }
+}
 
-        source_rect.x = 4 * (scale_factor * mode_scale);
-        source_rect.y = 0;
-        source_rect.w = width - (4 * (scale_factor * mode_scale));
-        source_rect.h = height;
+/******************************************************************************/
 
-        dest_rect.x = 0;
-        dest_rect.y = 0;
-        dest_rect.w = 0;
-        dest_rect.h = 0;
+/**
+ * Shifts a single packed row of the display to the right by the specified
+ * number of native pixels. Pixels shifted in from the left are turned off.
+ *
+ * @param row the packed row to shift
+ * @param num_pixels the number of native pixels to shift by
+ */
+void
+screen_shift_row_right(byte *row, int num_pixels)
+{
+    int byte_shift = num_pixels / 8;
+    int bit_shift = num_pixels % 8;
 
-        SDL_BlitSurface(surface, &source_rect, temp_surface, &dest_rect);
-        SDL_FreeSurface(surface);
-        surface = temp_surface;
-        return;
+    for (int x = SCREEN_ROW_BYTES - 1; x >= 0; x--) {
+        int source = x - byte_shift;
+        byte low = (source >= 0) ? row[source] : 0;
+        byte high = (source - 1 >= 0) ? row[source - 1] : 0;
+        row[x] = bit_shift ? (byte) ((low >> bit_shift) | (high << (8 - bit_shift))) : low;
     }
+}
 
-    // Blank out any pixels in the left 4 vertical lines we will copy to
-    for (int x = 0; x < 4; x++) {
-        for (int y = 0; y < max_y; y++) {
-            draw_pixel(x, y, FALSE, plane);
-        }
-    }
+/******************************************************************************/
 
-    // Start copying pixels from the right to the left and shift by 4 pixels
-    for (int x = 4; x < max_x; x++) {
-        for (int y = 0; y < max_y; y++) {
-            int current_pixel = get_pixel(x, y, plane);
-            draw_pixel(x, y, FALSE, plane);
-            draw_pixel(x - 4, y, current_pixel, plane);
-        }
+/**
+ * Scrolls the screen left by 4 pixels.
+ * 
+ * @param plane the bitplane to scroll
+ */
+void
+screen_scroll_left(int plane) 
+{
+    int num_pixels = 4 * screen_get_mode_scale();
+
+    if (plane & 0x3) {
+        screen_mark_dirty(SCREEN_ALL_ROWS);
     }
 
-    // Blank out any pixels in the right 4 vertical columns
-    for (int x = max_x - 4; x < max_x; x++) {
-        for (int y = 0; y < max_y; y++) {
-            draw_pixel(x, y, FALSE, plane);
+    for (int p = 0; p < SCREEN_PLANES; p++) {
+        if (plane & (1 << p)) {
+            for (int y = 0; y < SCREEN_HEIGHT; y++) {
+                screen_shift_row_left(display.plane[p][y], num_pixels);
+            }
         }
     }
 }
@@ -421,59 +358,17 @@ screen_scroll_left(int plane)
 void
 screen_scroll_right(int plane) 
 {
-    if (plane == 0) {
-        return;
-    }
-
-    int mode_scale = screen_get_mode_scale();
-    int width = screen_get_width() * scale_factor * mode_scale;
-    int height = screen_get_height() * scale_factor * mode_scale;
-
-    if (bitplane == 3) {
-        SDL_Rect source_rect, dest_rect;
-        int right = scale_factor * 4 * mode_scale;
-
-        SDL_Surface *temp_surface = create_surface(width, height);
-
-        source_rect.x = 0;
-        source_rect.y = 0;
-        source_rect.w = width - right;
-        source_rect.h = height;
-
-        dest_rect.x = right;
-        dest_rect.y = 0;
-        dest_rect.w = 0;
-        dest_rect.h = 0;
-
-        SDL_BlitSurface(surface, &source_rect, temp_surface, &dest_rect);
-        SDL_FreeSurface(surface);
-        surface = temp_surface;
-        return;
-    }
-
-    int max_x = screen_get_width();
-    int max_y = screen_get_height();
-
-    // Blank out any pixels in the right vertical lines that we will copy to
-    for (int x = max_x - 4; x < max_x; x++) {
-        for (int y = 0; y < max_y; y++) {
-            draw_pixel(x, y, FALSE, plane);
-        }
-    }
+    int num_pixels = 4 * screen_get_mode_scale();
 
-    // Start copying pixels from the left to the right and shift by 4 pixels
-    for (int x = max_x - 4 - 1; x > -1; x--) {
-        for (int y = 0; y < max_y; y++) {
-            int current_pixel = get_pixel(x, y, plane);
-            draw_pixel(x, y, FALSE, bitplane);
-            draw_pixel(x + 4, y, current_pixel, plane);
-        }
+    if (plane & 0x3) {
+        screen_mark_dirty(SCREEN_ALL_ROWS);
     }
 
-    // Blank out any pixels in the left 4 vertical lines
-    for (int x = 0; x < 4; x++) {
-        for (int y = 0; y < max_y; y++) {
-            draw_pixel(x, y, FALSE, plane);
+    for (int p = 0; p < SCREEN_PLANES; p++) {
+        if (plane & (1 << p)) {
+            for (int y = 0; y < SCREEN_HEIGHT; y++) {
+                screen_shift_row_right(display.plane[p][y], num_pixels);
+            }
         }
     }
 }
@@ -489,57 +384,19 @@ screen_scroll_right(int plane)
 void
 screen_scroll_down(int num_pixels, int plane) 
 {
-    if (plane == 0) {
-        return;
+    int rows = num_pixels * screen_get_mode_scale();
+    if (rows > SCREEN_HEIGHT) {
+        rows = SCREEN_HEIGHT;
     }
 
-    int width = screen_get_width() * scale_factor;
-    int height = screen_get_height() * scale_factor;
-    int mode_scale = screen_is_extended_mode() ? 1 : 2;
-
-    if (plane == 3) {    
-        SDL_Surface *temp_surface = create_surface(width, height);
-        SDL_Rect source_rect, dest_rect;
-
-        source_rect.x = 0;
-        source_rect.y = 0;
-        source_rect.w = width;
-        source_rect.h = height;
-
-        dest_rect.x = 0;
-        dest_rect.y = (num_pixels * scale_factor * mode_scale);
-        dest_rect.w = 0;
-        dest_rect.h = 0;
-
-        SDL_BlitSurface(surface, &source_rect, temp_surface, &dest_rect);
-        SDL_FreeSurface(surface);
-        surface = temp_surface;
-        return;
-    }
-
-    int max_x = width;
-    int max_y = height;
-
-    // Blank out any pixels in the bottom num_pixels that we will copy to
-    for (int x = 0; x < max_x; x++) {
-        for (int y = max_y - num_pixels; y < max_y; y++) {
-            draw_pixel(x, y, FALSE, plane);
-        }
+    if (plane & 0x3) {
+        screen_mark_dirty(SCREEN_ALL_ROWS);
     }
 
-    // Start copying pixels from the top to the bottom and shift by num_pixels
-    for (int x = 0; x < max_x; x++) {
-        for (int y = max_y - num_pixels - 1; y > -1; y--) {
-            int current_pixel = get_pixel(x, y, plane);
-            draw_pixel(x, y, FALSE, plane);
-            draw_pixel(x, y + num_pixels, current_pixel, plane);
-        }
-    }
-
-    // Blank out any pixels in the first num_pixels horizontal lines
-    for (int x = 0; x < max_x; x++) {
-        for (int y = 0; y < num_pixels; y++) {
-            draw_pixel(x, y, FALSE, plane);
+    for (int p = 0; p < SCREEN_PLANES; p++) {
+        if (plane & (1 << p)) {
+            memmove(display.plane[p][rows], display.plane[p][0], (SCREEN_HEIGHT - rows) * SCREEN_ROW_BYTES);
+            memset(display.plane[p][0], 0, rows * SCREEN_ROW_BYTES);
         }
     }
 }
@@ -555,57 +412,19 @@ screen_scroll_down(int num_pixels, int plane)
 void
 screen_scroll_up(int num_pixels, int plane) 
 {
-    if (plane == 0) {
-        return;
+    int rows = num_pixels * screen_get_mode_scale();
+    if (rows > SCREEN_HEIGHT) {
+        rows = SCREEN_HEIGHT;
     }
 
-    int width = screen_get_width() * scale_factor;
-    int height = screen_get_height() * scale_factor;
-    int mode_scale = screen_is_extended_mode() ? 1 : 2;
-
-    if (plane == 3) {    
-        SDL_Surface *temp_surface = create_surface(width, height);
-        SDL_Rect source_rect, dest_rect;
-
-        source_rect.x = 0;
-        source_rect.y = (num_pixels * scale_factor * mode_scale);
-        source_rect.w = width;
-        source_rect.h = height;
-
-        dest_rect.x = 0;
-        dest_rect.y = 0;
-        dest_rect.w = 0;
-        dest_rect.h = 0;
-
-        SDL_BlitSurface(surface, &source_rect, temp_surface, &dest_rect);
-        SDL_FreeSurface(surface);
-        surface = temp_surface;
-        return;
-    }
-
-    int max_x = screen_get_width();
-    int max_y = screen_get_height();
-
-    // Blank out any pixels in the top numPixels that we will copy to
-    for (int x = 0; x < max_x; x++) {
-        for (int y = 0; y < num_pixels; y++) {
-            draw_pixel(x, y, FALSE, plane);
-        }
-    }
-
-    // Start copying pixels from the top to the bottom and shift up by numPixels
-    for (int x = 0; x < max_x; x++) {
-        for (int y = num_pixels; y < max_y; y++) {
-            int currentPixel = get_pixel(x, y, plane);
-            draw_pixel(x, y, FALSE, plane);
-            draw_pixel(x, y - num_pixels, currentPixel, plane);
-        }
+    if (plane & 0x3) {
+        screen_mark_dirty(SCREEN_ALL_ROWS);
     }
 
-    // Blank out any piels in the bottom numPixels
-    for (int x = 0; x < max_x; x++) {
-        for (int y = max_y - num_pixels; y < max_y; y++) {
-            draw_pixel(x, y, FALSE, plane);
+    for (int p = 0; p < SCREEN_PLANES; p++) {
+        if (plane & (1 << p)) {
+            memmove(display.plane[p][0], display.plane[p][rows], (SCREEN_HEIGHT - rows) * SCREEN_ROW_BYTES);
+            memset(display.plane[p][SCREEN_HEIGHT - rows], 0, rows * SCREEN_ROW_BYTES);
         }
     }    
 }
@@ -652,4 +471,108 @@ screen_get_mode_scale(void)
     return screen_is_extended_mode() ? 1 : 2;
 }
 
+/******************************************************************************/
+
+/**
+ * Marks native rows of the display as changed, so that they are rehashed the
+ * next time screen_hash is called. Anything that writes to the bitplanes
+ * directly must call this.
+ *
+ * @param rows one bit per native row, with bit 0 being the top row
+ */
+void
+screen_mark_dirty(Uint64 rows)
+{
+    screen_dirty_rows |= rows;
+}
+
+/******************************************************************************/
+
+/**
+ * Mixes the bits of a 64-bit value together (the splitmix64 finalizer).
+ *
+ * @param value the value to mix
+ * @returns the mixed value
+ */
+static Uint64
+screen_hash_mix(Uint64 value)
+{
+    value ^= value >> 30;
+    value *= 0xBF58476D1CE4E5B9ULL;
+    value ^= value >> 27;
+    value *= 0x94D049BB133111EBULL;
+    value ^= value >> 31;
+    return value;
+}
+
+/******************************************************************************/
+
+/**
+ * Hashes a single native row across both bitplanes. Bytes are combined in a
+ * fixed order, so the hash is the same on big and little-endian hosts.
+ *
+ * @param source the display to hash
+ * @param row the native row to hash
+ * @returns the hash of the row
+ */
+static Uint64
+screen_hash_row(const chip8display *source, int row)
+{
+    Uint64 hash = screen_hash_mix(row + 1);
+
+    for (int p = 0; p < SCREEN_PLANES; p++) {
+        for (int x = 0; x < SCREEN_ROW_BYTES; x += 8) {
+            Uint64 word = 0;
+            for (int b = 0; b < 8; b++) {
+                word = (word << 8) | source->plane[p][row][x + b];
+            }
+            hash = screen_hash_mix(hash ^ word);
+        }
+    }
+    return hash;
+}
+
+/******************************************************************************/
+
+/**
+ * Hashes a display and screen mode from scratch. This always gives the same
+ * result as screen_hash, but does not use (or update) the row hashes.
+ *
+ * @param source the display to hash
+ * @param mode the screen mode to include in the hash
+ * @returns the 64-bit hash of the display
+ */
+Uint64
+screen_hash_display(const chip8display *source, int mode)
+{
+    Uint64 rows_hash = 0;
+    for (int row = 0; row < SCREEN_HEIGHT; row++) {
+        rows_hash ^= screen_hash_row(source, row);
+    }
+    return screen_hash_mix(rows_hash ^ (SCREEN_HASH_MODE * (Uint64) (mode + 1)));
+}
+
+/******************************************************************************/
+
+/**
+ * Returns a 64-bit hash of both bitplanes and the screen mode. Only the rows
+ * that changed since the last call are rehashed, so calling this every frame
+ * costs very little when the screen is mostly static.
+ *
+ * @returns the 64-bit hash of the display
+ */
+Uint64
+screen_hash(void)
+{
+    for (int row = 0; screen_dirty_rows != 0; row++) {
+        if (screen_dirty_rows & ((Uint64) 1 << row)) {
+            Uint64 row_hash = screen_hash_row(&display, row);
+            screen_rows_hash ^= screen_row_hashes[row] ^ row_hash;
+            screen_row_hashes[row] = row_hash;
+            screen_dirty_rows &= ~((Uint64) 1 << row);
+        }
+    }
+    return screen_hash_mix(screen_rows_hash ^ (SCREEN_HASH_MODE * (Uint64) (screen_mode + 1)));
+}
+
 /* E N D   O F   F I L E ******************************************************/
@@ -18,12 +18,15 @@ void
 setup_screen_test(void) 
 {
     scale_factor = 1;
+    video = video_select("memory");
     CU_TEST_FATAL(screen_init());
+    CU_TEST_FATAL(video->init());
 }
 
 void 
 teardown_screen_test(void)
 {
+    video->destroy();
     screen_destroy();
 }
 
@@ -371,4 +374,54 @@ test_screen_is_mode_extended_correct(void)
     CU_ASSERT_FALSE(screen_is_extended_mode());
 }
 
+void
+test_screen_hash_matches_full_hash(void)
+{
+    setup_screen_test();
+    screen_set_normal_mode();
+    CU_ASSERT_EQUAL(screen_hash_display(&display, screen_mode), screen_hash());
+
+    draw_pixel(10, 10, 1, 1);
+    draw_pixel(20, 5, 1, 2);
+    CU_ASSERT_EQUAL(screen_hash_display(&display, screen_mode), screen_hash());
+
+    screen_scroll_down(3, 3);
+    screen_scroll_left(1);
+    CU_ASSERT_EQUAL(screen_hash_display(&display, screen_mode), screen_hash());
+
+    screen_set_extended_mode();
+    draw_pixel(127, 63, 1, 3);
+    screen_scroll_up(1, 2);
+    CU_ASSERT_EQUAL(screen_hash_display(&display, screen_mode), screen_hash());
+    screen_set_normal_mode();
+    teardown_screen_test();
+}
+
+void
+test_screen_hash_changes(void)
+{
+    setup_screen_test();
+    screen_set_normal_mode();
+    Uint64 blank = screen_hash();
+
+    draw_pixel(10, 10, 1, 1);
+    Uint64 plane_1 = screen_hash();
+    CU_ASSERT_NOT_EQUAL(blank, plane_1);
+
+    draw_pixel(10, 10, 0, 1);
+    CU_ASSERT_EQUAL(blank, screen_hash());
+
+    draw_pixel(10, 10, 1, 2);
+    CU_ASSERT_NOT_EQUAL(blank, screen_hash());
+    CU_ASSERT_NOT_EQUAL(plane_1, screen_hash());
+
+    screen_blank(3);
+    CU_ASSERT_EQUAL(blank, screen_hash());
+
+    screen_set_extended_mode();
+    CU_ASSERT_NOT_EQUAL(blank, screen_hash());
+    screen_set_normal_mode();
+    teardown_screen_test();
+}
+
 /* E N D   O F   F I L E *****************************************************/
\ No newline at end of file
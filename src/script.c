@@ -0,0 +1,179 @@
+/**
+ * Copyright (C) 2025 Craig Thomas
+ * This project uses an MIT style license - see the LICENSE file for details.
+ *
+ * @file      script.c
+ * @brief     Routines for driving the keypad from an input script
+ * @author    Craig Thomas
+ *
+ * An input script holds one command per line, either `FRAME KEY down`,
+ * `FRAME KEY up` or `FRAME quit`. FRAME is the number of frames that have
+ * been completed when the command takes effect (so 0 is before the first
+ * instruction runs), and KEY is an emulator key in hex. Blank lines and
+ * lines starting with `#` are ignored, and commands are expected to be in
+ * frame order.
+ *
+ * The script is read by the CPU thread in the input phase of each frame, and
+ * only up to the first command for a later frame. When the script is a pipe,
+ * the CPU waits for that command to arrive, so the emulator runs in lockstep
+ * with whatever is writing the script. Either way, each command lands on
+ * exactly the same guest frame on every run.
+ */
+
+/* I N C L U D E S ************************************************************/
+
+#include <ctype.h>
+#include <stdlib.h>
+#include "globals.h"
+
+/* L O C A L S ****************************************************************/
+
+/*!
+ * The script being read, and its name and current line for error messages
+ */
+static FILE *script_file;
+static const char *script_name;
+static int script_line_number;
+
+/*!
+ * The number of frames completed so far
+ */
+static Uint32 script_frame;
+
+/*!
+ * The next command to apply, and whether there is one
+ */
+static chip8scriptcommand script_next;
+static int script_pending;
+
+/* F U N C T I O N S **********************************************************/
+
+/**
+ * Reads the next command from the script into `script_next`. Lines that
+ * cannot be parsed are reported and skipped. Returns FALSE once the end of
+ * the script is reached.
+ *
+ * @returns TRUE if a command was read, FALSE otherwise
+ */
+static int
+script_read(void)
+{
+    char line[MAXSTRSIZE];
+    char first[MAXSTRSIZE];
+    char second[MAXSTRSIZE];
+    unsigned int frame;
+
+    while (fgets(line, sizeof(line), script_file) != NULL) {
+        script_line_number++;
+        char *start = line;
+        while (isspace((unsigned char) *start)) {
+            start++;
+        }
+        if (*start == '\0' || *start == '#') {
+            continue;
+        }
+
+        int fields = sscanf(start, "%u %s %s", &frame, first, second);
+        if (fields == 2 && strcmp(first, "quit") == 0) {
+            script_next.frame = frame;
+            script_next.type = INPUT_QUIT;
+            script_next.key = 0;
+            return TRUE;
+        }
+
+        char *end;
+        long key = (fields == 3) ? strtol(first, &end, 16) : -1;
+        if (key < 0 || key >= KEY_NUMBEROFKEYS || *end != '\0' ||
+                (strcmp(second, "down") != 0 && strcmp(second, "up") != 0)) {
+            printf("Error: %s:%d: expected FRAME KEY down|up or FRAME quit\n", script_name, script_line_number);
+            continue;
+        }
+        script_next.frame = frame;
+        script_next.type = (strcmp(second, "down") == 0) ? INPUT_KEYDOWN : INPUT_KEYUP;
+        script_next.key = key;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/******************************************************************************/
+
+/**
+ * Opens an input script and reads its first command. A filename of `-` reads
+ * the script from standard input. Returns FALSE if the script could not be
+ * opened.
+ *
+ * @param filename the name of the script file, FIFO, or `-`
+ * @returns TRUE on success, FALSE otherwise
+ */
+int
+script_init(const char *filename)
+{
+    script_destroy();
+    if (strcmp(filename, "-") == 0) {
+        script_file = stdin;
+    } else {
+        script_file = fopen(filename, "r");
+        if (script_file == NULL) {
+            printf("Error: could not open input script: %s\n", filename);
+            return FALSE;
+        }
+    }
+    script_name = filename;
+    script_line_number = 0;
+    script_frame = 0;
+    script_pending = script_read();
+    return TRUE;
+}
+
+/******************************************************************************/
+
+/**
+ * Applies every command that is due by the current frame, and then moves on
+ * to the next frame. Called by the CPU once before the first instruction,
+ * and then once at the start of every frame. Does nothing if there is no
+ * script.
+ */
+void
+script_advance(void)
+{
+    if (script_file == NULL) {
+        return;
+    }
+
+    while (script_pending && script_next.frame <= script_frame) {
+        switch (script_next.type) {
+            case INPUT_KEYDOWN:
+                keyboard_set_state(keyboard_get_state() | (1 << script_next.key));
+                cpu_keypress(script_next.key);
+                break;
+
+            case INPUT_KEYUP:
+                keyboard_set_state(keyboard_get_state() & ~(1 << script_next.key));
+                break;
+
+            default:
+                cpu.state = CPU_STOP;
+                break;
+        }
+        script_pending = script_read();
+    }
+    script_frame++;
+}
+
+/******************************************************************************/
+
+/**
+ * Closes the input script, if there is one.
+ */
+void
+script_destroy(void)
+{
+    if (script_file != NULL && script_file != stdin) {
+        fclose(script_file);
+    }
+    script_file = NULL;
+    script_pending = FALSE;
+}
+
+/* E N D   O F   F I L E ******************************************************/
@@ -0,0 +1,75 @@
+/**
+ * Copyright (C) 2025 Craig Thomas
+ * This project uses an MIT style license - see the LICENSE file for details.
+ *
+ * @file      script_test.c
+ * @brief     Tests for the input script functions
+ * @author    Craig Thomas
+ */
+
+/* I N C L U D E S ************************************************************/
+
+#include <CUnit/CUnit.h>
+#include "globals.h"
+
+/* F U N C T I O N S **********************************************************/
+
+void
+test_script_applies_commands_on_frames(void)
+{
+    FILE *fp = fopen("test_script.txt", "w");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(fp);
+    fprintf(fp, "# Press 5 before the first instruction, then F on frame 2\n");
+    fprintf(fp, "0 5 down\n2 f down\n\n3 5 up\n3 F up\n5 quit\n");
+    fclose(fp);
+
+    cpu_reset();
+    keyboard_set_state(0);
+    cpu.state = CPU_RUNNING;
+    CU_ASSERT_TRUE_FATAL(script_init("test_script.txt"));
+    remove("test_script.txt");
+
+    script_advance();
+    CU_ASSERT_EQUAL(0x0020, keyboard_get_state());
+    script_advance();
+    CU_ASSERT_EQUAL(0x0020, keyboard_get_state());
+
+    // A scripted key press also satisfies FX0A
+    cpu.operand.WORD = 0xF20A;
+    awaiting_keypress = TRUE;
+    script_advance();
+    CU_ASSERT_EQUAL(0x8020, keyboard_get_state());
+    CU_ASSERT_EQUAL(0xF, cpu.v[2]);
+    CU_ASSERT_FALSE(awaiting_keypress);
+
+    script_advance();
+    CU_ASSERT_EQUAL(0, keyboard_get_state());
+    script_advance();
+    CU_ASSERT_EQUAL(CPU_RUNNING, cpu.state);
+    script_advance();
+    CU_ASSERT_EQUAL(CPU_STOP, cpu.state);
+
+    script_destroy();
+    cpu_reset();
+}
+
+void
+test_script_skips_bad_lines(void)
+{
+    FILE *fp = fopen("test_script.txt", "w");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(fp);
+    fprintf(fp, "0 10 down\n0 g down\n0 1 sideways\nstart\n0 1 down\n");
+    fclose(fp);
+
+    keyboard_set_state(0);
+    CU_ASSERT_TRUE_FATAL(script_init("test_script.txt"));
+    remove("test_script.txt");
+    script_advance();
+    CU_ASSERT_EQUAL(0x0002, keyboard_get_state());
+
+    script_destroy();
+    keyboard_set_state(0);
+    CU_ASSERT_FALSE(script_init("no_such_script.txt"));
+}
+
+/* E N D   O F   F I L E ******************************************************/
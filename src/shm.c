@@ -0,0 +1,277 @@
+/**
+ * Copyright (C) 2025 Craig Thomas
+ * This project uses an MIT style license - see the LICENSE file for details.
+ *
+ * @file      shm.c
+ * @brief     Routines for exporting the screen through shared memory
+ * @author    Craig Thomas
+ *
+ * When enabled, the emulator creates a POSIX shared memory segment holding a
+ * chip8shared structure: the packed bitplanes, the palette, a frame counter
+ * and a snapshot of the registers. The segment is updated once per frame by
+ * the CPU thread, so external viewers can watch the emulator without ever
+ * touching its window.
+ *
+ * Updates are protected by a sequence lock. The writer makes the sequence
+ * number odd before changing the segment, and even again once it is done.
+ * A reader copies the segment, and keeps the copy only if the sequence
+ * number was even and unchanged from before the copy to after it. Readers
+ * never block the writer, and never keep a torn frame. The lock only works
+ * with a single writer, so a segment is never shared by two emulators: one
+ * that is still in use by a running emulator cannot be created again.
+ */
+
+/* I N C L U D E S ************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "globals.h"
+
+/* L O C A L S ****************************************************************/
+
+/*!
+ * The segment published by the emulator, or NULL if it is not exported
+ */
+static chip8shared *shm_segment;
+
+/*!
+ * The name of the published segment
+ */
+static char shm_segment_name[MAXSTRSIZE];
+
+/* F U N C T I O N S **********************************************************/
+
+/**
+ * Turns a segment name into a POSIX shared memory object name, which must
+ * start with a slash.
+ *
+ * @param name the name of the segment
+ * @param buffer where to store the object name
+ * @param length the size of the buffer
+ */
+static void
+shm_object_name(const char *name, char *buffer, size_t length)
+{
+    snprintf(buffer, length, "%s%s", name[0] == '/' ? "" : "/", name);
+}
+
+/******************************************************************************/
+
+/**
+ * Checks whether an existing segment was left behind by an emulator that is
+ * no longer running (for example, one that crashed), so that it can be
+ * replaced.
+ *
+ * @param object_name the object name of the segment
+ * @returns TRUE if the segment is stale, FALSE if it is in use or unknown
+ */
+static int
+shm_segment_stale(const char *object_name)
+{
+    const chip8shared *shared = shm_attach(object_name);
+    if (shared == NULL) {
+        return FALSE;
+    }
+    pid_t pid = (pid_t) shared->pid;
+    shm_detach(shared);
+    return pid > 0 && kill(pid, 0) != 0 && errno == ESRCH;
+}
+
+/******************************************************************************/
+
+/**
+ * Creates the shared memory segment that the screen is exported to. Returns
+ * FALSE if the segment could not be created, or if another emulator that is
+ * still running already exports a segment with the same name.
+ *
+ * @param name the name of the segment
+ * @returns TRUE if the segment was created, FALSE otherwise
+ */
+int
+shm_init(const char *name)
+{
+    char object_name[MAXSTRSIZE];
+
+    shm_object_name(name, object_name, sizeof(object_name));
+    int fd = shm_open(object_name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    int taken = fd < 0 && errno == EEXIST;
+    if (taken && shm_segment_stale(object_name)) {
+        shm_unlink(object_name);
+        fd = shm_open(object_name, O_CREAT | O_EXCL | O_RDWR, 0644);
+        taken = fd < 0 && errno == EEXIST;
+    }
+    if (taken) {
+        printf("Error: shared memory segment is in use by another emulator: %s\n", object_name);
+        return FALSE;
+    }
+    if (fd < 0) {
+        printf("Error: could not create shared memory segment: %s\n", object_name);
+        return FALSE;
+    }
+
+    if (ftruncate(fd, sizeof(chip8shared)) != 0) {
+        printf("Error: could not size shared memory segment: %s\n", object_name);
+        close(fd);
+        shm_unlink(object_name);
+        return FALSE;
+    }
+
+    void *segment = mmap(NULL, sizeof(chip8shared), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (segment == MAP_FAILED) {
+        printf("Error: could not map shared memory segment: %s\n", object_name);
+        shm_unlink(object_name);
+        return FALSE;
+    }
+
+    strcpy(shm_segment_name, object_name);
+    shm_segment = (chip8shared *) segment;
+    memset(shm_segment, 0, sizeof(chip8shared));
+    shm_segment->version = SHM_VERSION;
+    shm_segment->size = sizeof(chip8shared);
+    shm_segment->pid = (Uint32) getpid();
+    __atomic_store_n(&shm_segment->magic, SHM_MAGIC, __ATOMIC_RELEASE);
+    return TRUE;
+}
+
+/******************************************************************************/
+
+/**
+ * Publishes the current screen, palette and registers to the shared memory
+ * segment. Does nothing if the screen is not being exported. Must be called
+ * once per frame from the CPU thread.
+ */
+void
+shm_publish(void)
+{
+    if (shm_segment == NULL) {
+        return;
+    }
+
+    Uint32 sequence = shm_segment->sequence;
+    __atomic_store_n(&shm_segment->sequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    shm_segment->frame++;
+    shm_segment->screen_mode = screen_mode;
+    for (int color = 0; color < 4; color++) {
+        shm_segment->palette[color] = get_bitplane_color(color);
+    }
+    memcpy(shm_segment->v, cpu.v, sizeof(shm_segment->v));
+    memcpy(shm_segment->rpl, cpu.rpl, sizeof(shm_segment->rpl));
+    shm_segment->i = cpu.i.WORD;
+    shm_segment->pc = cpu.pc.WORD;
+    shm_segment->sp = cpu.sp.WORD;
+    shm_segment->dt = cpu.dt;
+    shm_segment->st = cpu.st;
+    memcpy(&shm_segment->display, &display, sizeof(chip8display));
+
+    __atomic_store_n(&shm_segment->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+/******************************************************************************/
+
+/**
+ * Removes the shared memory segment.
+ */
+void
+shm_destroy(void)
+{
+    if (shm_segment == NULL) {
+        return;
+    }
+    munmap(shm_segment, sizeof(chip8shared));
+    shm_unlink(shm_segment_name);
+    shm_segment = NULL;
+}
+
+/******************************************************************************/
+
+/**
+ * Maps a segment published by another emulator for reading. Returns NULL if
+ * the segment does not exist, or was published by an incompatible version.
+ *
+ * @param name the name of the segment
+ * @returns the mapped segment, or NULL on failure
+ */
+const chip8shared *
+shm_attach(const char *name)
+{
+    char object_name[MAXSTRSIZE];
+    struct stat info;
+
+    shm_object_name(name, object_name, sizeof(object_name));
+    int fd = shm_open(object_name, O_RDONLY, 0);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    if (fstat(fd, &info) != 0 || info.st_size < (off_t) sizeof(chip8shared)) {
+        close(fd);
+        return NULL;
+    }
+
+    void *segment = mmap(NULL, sizeof(chip8shared), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (segment == MAP_FAILED) {
+        return NULL;
+    }
+
+    const chip8shared *shared = (const chip8shared *) segment;
+    if (__atomic_load_n(&shared->magic, __ATOMIC_ACQUIRE) != SHM_MAGIC ||
+            shared->version != SHM_VERSION || shared->size != sizeof(chip8shared)) {
+        munmap(segment, sizeof(chip8shared));
+        return NULL;
+    }
+    return shared;
+}
+
+/******************************************************************************/
+
+/**
+ * Unmaps a segment mapped with shm_attach.
+ *
+ * @param shared the segment to unmap
+ */
+void
+shm_detach(const chip8shared *shared)
+{
+    munmap((void *) shared, sizeof(chip8shared));
+}
+
+/******************************************************************************/
+
+/**
+ * Takes a consistent copy of a shared segment. The copy is retried a few
+ * times if the writer is in the middle of an update. Returns FALSE if no
+ * consistent copy could be made, in which case the caller should try again
+ * later.
+ *
+ * @param shared the segment to copy
+ * @param copy where to store the copy
+ * @returns TRUE if the copy is consistent, FALSE otherwise
+ */
+int
+shm_read(const chip8shared *shared, chip8shared *copy)
+{
+    for (int attempt = 0; attempt < SHM_READ_ATTEMPTS; attempt++) {
+        Uint32 before = __atomic_load_n(&shared->sequence, __ATOMIC_ACQUIRE);
+        if (before & 1) {
+            continue;
+        }
+
+        memcpy(copy, shared, sizeof(chip8shared));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+        if (__atomic_load_n(&shared->sequence, __ATOMIC_RELAXED) == before) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/* E N D   O F   F I L E ******************************************************/
@@ -0,0 +1,121 @@
+/**
+ * Copyright (C) 2025 Craig Thomas
+ * This project uses an MIT style license - see the LICENSE file for details.
+ *
+ * @file      shm_test.c
+ * @brief     Tests for the shared memory export functions
+ * @author    Craig Thomas
+ */
+
+/* I N C L U D E S ************************************************************/
+
+#include <CUnit/CUnit.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "globals.h"
+
+/* F U N C T I O N S **********************************************************/
+
+void
+test_shm_publish_and_read(void)
+{
+    chip8shared copy;
+
+    CU_TEST_FATAL(screen_init());
+    CU_TEST_FATAL(shm_init("yac8e-test"));
+    draw_pixel(0, 0, 1, 1);
+    cpu.v[3] = 0x42;
+    cpu.pc.WORD = 0x234;
+    shm_publish();
+    shm_publish();
+
+    const chip8shared *shared = shm_attach("/yac8e-test");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(shared);
+    CU_ASSERT_TRUE(shm_read(shared, &copy));
+    CU_ASSERT_EQUAL(4, copy.sequence);
+    CU_ASSERT_EQUAL(2, copy.frame);
+    CU_ASSERT_EQUAL(0x42, copy.v[3]);
+    CU_ASSERT_EQUAL(0x234, copy.pc);
+    CU_ASSERT_EQUAL(COLOR_1, copy.palette[1]);
+    CU_ASSERT_EQUAL(0, memcmp(&display, &copy.display, sizeof(chip8display)));
+    shm_detach(shared);
+
+    shm_destroy();
+    CU_ASSERT_PTR_NULL(shm_attach("yac8e-test"));
+    cpu.v[3] = 0;
+    cpu.pc.WORD = 0;
+    screen_destroy();
+}
+
+void
+test_shm_read_skips_update_in_progress(void)
+{
+    chip8shared shared;
+    chip8shared copy;
+
+    memset(&shared, 0, sizeof(shared));
+    shared.sequence = 3;
+    CU_ASSERT_FALSE(shm_read(&shared, &copy));
+    shared.sequence = 4;
+    CU_ASSERT_TRUE(shm_read(&shared, &copy));
+}
+
+void
+test_shm_init_fails_while_segment_in_use(void)
+{
+    CU_TEST_FATAL(screen_init());
+    CU_TEST_FATAL(shm_init("yac8e-test"));
+    shm_publish();
+
+    // The first segment is still live, so it is neither taken over nor reset
+    CU_ASSERT_FALSE(shm_init("yac8e-test"));
+    const chip8shared *shared = shm_attach("yac8e-test");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(shared);
+    CU_ASSERT_EQUAL(1, shared->frame);
+    CU_ASSERT_EQUAL((Uint32) getpid(), shared->pid);
+    shm_detach(shared);
+
+    shm_destroy();
+    CU_ASSERT_PTR_NULL(shm_attach("yac8e-test"));
+    screen_destroy();
+}
+
+void
+test_shm_init_replaces_stale_segment(void)
+{
+    // Leave a segment behind as an emulator that has since exited would
+    pid_t child = fork();
+    CU_ASSERT_TRUE_FATAL(child >= 0);
+    if (child == 0) {
+        _exit(0);
+    }
+    waitpid(child, NULL, 0);
+
+    int fd = shm_open("/yac8e-test", O_CREAT | O_EXCL | O_RDWR, 0644);
+    CU_ASSERT_TRUE_FATAL(fd >= 0);
+    CU_ASSERT_EQUAL_FATAL(0, ftruncate(fd, sizeof(chip8shared)));
+    chip8shared *stale = mmap(NULL, sizeof(chip8shared), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    CU_ASSERT_TRUE_FATAL(stale != MAP_FAILED);
+    stale->magic = SHM_MAGIC;
+    stale->version = SHM_VERSION;
+    stale->size = sizeof(chip8shared);
+    stale->pid = (Uint32) child;
+    stale->frame = 99;
+    munmap(stale, sizeof(chip8shared));
+
+    CU_TEST_FATAL(screen_init());
+    CU_ASSERT_TRUE(shm_init("yac8e-test"));
+    const chip8shared *shared = shm_attach("yac8e-test");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(shared);
+    CU_ASSERT_EQUAL(0, shared->frame);
+    CU_ASSERT_EQUAL((Uint32) getpid(), shared->pid);
+    shm_detach(shared);
+
+    shm_destroy();
+    screen_destroy();
+}
+
+/* E N D   O F   F I L E ******************************************************/
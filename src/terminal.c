@@ -0,0 +1,429 @@
+/**
+ * Copyright (C) 2025 Craig Thomas
+ * This project uses an MIT style license - see the LICENSE file for details.
+ *
+ * @file      terminal.c
+ * @brief     A video backend that draws the screen in a terminal
+ * @author    Craig Thomas
+ *
+ * The terminal backend draws the screen with the Unicode upper half block
+ * character, using the 24-bit ANSI foreground color for the top pixel and the
+ * background color for the bottom pixel. In normal mode, each logical pixel
+ * becomes one half of a character cell (64 x 16 cells), and in extended mode
+ * each native pixel does (128 x 32 cells).
+ *
+ * The backend remembers what is in every cell, and each frame only emits
+ * escape sequences for the cells that changed. Cursor movements and color
+ * changes are skipped when the terminal is already in the right state, which
+ * keeps the output small enough for slow SSH connections.
+ *
+ * Keyboard input is read from the terminal in raw mode. Terminals only
+ * report key presses, so a key is considered released TERMINAL_KEY_HOLD
+ * milliseconds after it was last seen (key repeat keeps a held key down).
+ */
+
+/* I N C L U D E S ************************************************************/
+
+#include <ctype.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <termios.h>
+#include <unistd.h>
+#include "globals.h"
+
+/* D E F I N E S **************************************************************/
+
+#define TERMINAL_ROWS      (SCREEN_HEIGHT / 2) /**< Most rows of cells        */
+#define TERMINAL_KEY_HOLD  150   /**< Milliseconds a key stays pressed        */
+#define TERMINAL_KEYS      128   /**< Number of keys that can be tracked      */
+#define TERMINAL_UNKNOWN   0xFF  /**< A cell with unknown contents            */
+#define TERMINAL_ESC_DELAY 25    /**< Milliseconds to wait after a lone escape */
+#define TERMINAL_SEQUENCE  16    /**< Longest escape sequence that is kept    */
+
+/* L O C A L S ****************************************************************/
+
+/*!
+ * The color indices of the top (bits 0 - 1) and bottom (bits 2 - 3) pixel
+ * in each character cell, as last drawn
+ */
+static byte terminal_cells[TERMINAL_ROWS][SCREEN_WIDTH];
+
+/*!
+ * The number of cell columns currently drawn (depends on the screen mode)
+ */
+static int terminal_columns;
+
+/*!
+ * The terminal state - cursor position (-1 if unknown) and current colors
+ * (-1 if unknown)
+ */
+static int terminal_cursor_row;
+static int terminal_cursor_column;
+static int terminal_foreground;
+static int terminal_background;
+
+/*!
+ * Output waiting to be written to the terminal
+ */
+static char terminal_output[8192];
+static size_t terminal_output_length;
+
+/*!
+ * The color index of every native pixel in the frame being drawn
+ */
+static byte terminal_indices[SCREEN_WIDTH * SCREEN_HEIGHT];
+
+/*!
+ * The terminal settings to restore on exit, and whether raw mode is active
+ */
+static struct termios terminal_saved_settings;
+static int terminal_raw;
+
+/*!
+ * The time at which each pressed key is released, or 0 if it is not pressed
+ */
+static Uint32 terminal_key_release[TERMINAL_KEYS];
+
+/*!
+ * An escape sequence that has only been partly read (it may continue in the
+ * next read), and the time its escape byte arrived
+ */
+static char terminal_sequence[TERMINAL_SEQUENCE];
+static int terminal_sequence_length;
+static Uint32 terminal_sequence_time;
+
+/* F U N C T I O N S **********************************************************/
+
+/**
+ * Writes out any buffered output.
+ *
+ * @param fd the file descriptor of the terminal
+ */
+static void
+terminal_flush(int fd)
+{
+    size_t written = 0;
+    while (written < terminal_output_length) {
+        ssize_t result = write(fd, terminal_output + written, terminal_output_length - written);
+        if (result <= 0) {
+            break;
+        }
+        written += result;
+    }
+    terminal_output_length = 0;
+}
+
+/******************************************************************************/
+
+/**
+ * Adds a formatted string to the output buffer, writing the buffer out first
+ * if there is not enough room.
+ *
+ * @param fd the file descriptor of the terminal
+ * @param format the printf style format string
+ */
+static void
+terminal_printf(int fd, const char *format, ...)
+{
+    char buffer[64];
+    va_list arguments;
+
+    va_start(arguments, format);
+    int length = vsnprintf(buffer, sizeof(buffer), format, arguments);
+    va_end(arguments);
+
+    if (terminal_output_length + length > sizeof(terminal_output)) {
+        terminal_flush(fd);
+    }
+    memcpy(terminal_output + terminal_output_length, buffer, length);
+    terminal_output_length += length;
+}
+
+/******************************************************************************/
+
+/**
+ * Forgets what is on the terminal, so that the next frame is drawn in full.
+ */
+void
+terminal_reset(void)
+{
+    memset(terminal_cells, TERMINAL_UNKNOWN, sizeof(terminal_cells));
+    terminal_columns = 0;
+    terminal_cursor_row = -1;
+    terminal_cursor_column = -1;
+    terminal_foreground = -1;
+    terminal_background = -1;
+    terminal_output_length = 0;
+}
+
+/******************************************************************************/
+
+/**
+ * Draws a frame on the terminal, only emitting the cells that changed since
+ * the last frame that was drawn.
+ *
+ * @param frame the frame to draw
+ * @param fd the file descriptor of the terminal
+ */
+void
+terminal_render(const chip8frame *frame, int fd)
+{
+    int scale = (frame->screen_mode == SCREEN_MODE_EXTENDED) ? 1 : 2;
+    int columns = SCREEN_WIDTH / scale;
+    int rows = SCREEN_HEIGHT / (2 * scale);
+
+    if (columns != terminal_columns) {
+        terminal_reset();
+        terminal_columns = columns;
+        terminal_printf(fd, "\033[0m\033[2J");
+    }
+
+    record_convert_indices(&frame->display, terminal_indices);
+    for (int row = 0; row < rows; row++) {
+        const byte *top = &terminal_indices[(row * 2) * scale * SCREEN_WIDTH];
+        const byte *bottom = &terminal_indices[(row * 2 + 1) * scale * SCREEN_WIDTH];
+
+        for (int column = 0; column < columns; column++) {
+            int upper = top[column * scale];
+            int lower = bottom[column * scale];
+            byte cell = (byte) (upper | (lower << 2));
+            if (terminal_cells[row][column] == cell) {
+                continue;
+            }
+            terminal_cells[row][column] = cell;
+
+            if (row != terminal_cursor_row || column != terminal_cursor_column) {
+                terminal_printf(fd, "\033[%d;%dH", row + 1, column + 1);
+            }
+            if (upper != terminal_foreground) {
+                Uint32 color = get_bitplane_color(upper);
+                terminal_printf(fd, "\033[38;2;%d;%d;%dm", (color >> 16) & 0xFF, (color >> 8) & 0xFF, color & 0xFF);
+                terminal_foreground = upper;
+            }
+            if (lower != terminal_background) {
+                Uint32 color = get_bitplane_color(lower);
+                terminal_printf(fd, "\033[48;2;%d;%d;%dm", (color >> 16) & 0xFF, (color >> 8) & 0xFF, color & 0xFF);
+                terminal_background = lower;
+            }
+            terminal_printf(fd, "\xE2\x96\x80");
+
+            // The cursor position after the last column depends on the terminal
+            terminal_cursor_row = row;
+            terminal_cursor_column = (column + 1 < columns) ? column + 1 : -1;
+        }
+    }
+    terminal_flush(fd);
+}
+
+/******************************************************************************/
+
+/**
+ * Presses a key, and holds it down for TERMINAL_KEY_HOLD milliseconds.
+ *
+ * @param key the key that was pressed
+ */
+static void
+terminal_press_key(SDL_Keycode key)
+{
+    if (key < 0 || key >= TERMINAL_KEYS) {
+        input_push(INPUT_KEYDOWN, key);
+        input_push(INPUT_KEYUP, key);
+        return;
+    }
+
+    if (terminal_key_release[key] == 0) {
+        input_push(INPUT_KEYDOWN, key);
+    }
+    terminal_key_release[key] = SDL_GetTicks() + TERMINAL_KEY_HOLD;
+    if (terminal_key_release[key] == 0) {
+        terminal_key_release[key] = 1;
+    }
+}
+
+/******************************************************************************/
+
+/**
+ * Checks whether the escape sequence read so far is complete. A control
+ * sequence (ESC [) ends with a byte from 0x40 to 0x7E, ESC O is followed by
+ * a single byte, and any other byte after the escape ends the sequence (as
+ * sent for Alt plus a key).
+ *
+ * @returns TRUE if the sequence is complete, FALSE otherwise
+ */
+static int
+terminal_sequence_complete(void)
+{
+    int last = terminal_sequence_length - 1;
+    if (terminal_sequence_length < 2) {
+        return FALSE;
+    }
+    if (terminal_sequence[1] == '[') {
+        return last >= 2 && terminal_sequence[last] >= 0x40 && terminal_sequence[last] <= 0x7E;
+    }
+    if (terminal_sequence[1] == 'O') {
+        return terminal_sequence_length == 3;
+    }
+    return TRUE;
+}
+
+/******************************************************************************/
+
+/**
+ * Turns the bytes read from the terminal into key presses. Escape sequences
+ * are ignored apart from F12, and may be split across reads, so the start of
+ * a sequence is kept until the rest of it arrives. An escape byte with
+ * nothing after it is only taken as the escape key once
+ * `terminal_process_escape` sees that nothing followed it.
+ *
+ * @param buffer the bytes read from the terminal
+ * @param length the number of bytes read
+ */
+void
+terminal_process_bytes(const char *buffer, int length)
+{
+    for (int n = 0; n < length; n++) {
+        if (terminal_sequence_length > 0) {
+            terminal_sequence[terminal_sequence_length++] = buffer[n];
+            if (terminal_sequence_complete()) {
+                if (terminal_sequence_length == 5 && memcmp(terminal_sequence, "\033[24~", 5) == 0) {
+                    terminal_press_key(SCREENSHOT_KEY);
+                }
+                terminal_sequence_length = 0;
+            } else if (terminal_sequence_length == TERMINAL_SEQUENCE) {
+                terminal_sequence_length = 0;
+            }
+            continue;
+        }
+
+        if (buffer[n] == '\033') {
+            terminal_sequence[0] = buffer[n];
+            terminal_sequence_length = 1;
+            terminal_sequence_time = SDL_GetTicks();
+            continue;
+        }
+        terminal_press_key(tolower((unsigned char) buffer[n]));
+    }
+}
+
+/******************************************************************************/
+
+/**
+ * Resolves an escape sequence that has not been finished within
+ * TERMINAL_ESC_DELAY milliseconds. A lone escape byte is the escape key, and
+ * anything longer is dropped.
+ *
+ * @param now the current time in milliseconds
+ */
+void
+terminal_process_escape(Uint32 now)
+{
+    if (terminal_sequence_length == 0 ||
+            (Sint32) (now - terminal_sequence_time) < TERMINAL_ESC_DELAY) {
+        return;
+    }
+    if (terminal_sequence_length == 1) {
+        terminal_press_key(SDLK_ESCAPE);
+    }
+    terminal_sequence_length = 0;
+}
+
+/******************************************************************************/
+
+/**
+ * Puts the terminal into raw mode, switches to the alternate screen and hides
+ * the cursor. Returns FALSE if the terminal could not be set up.
+ *
+ * @returns TRUE if the terminal was set up, FALSE otherwise
+ */
+int
+video_terminal_init(void)
+{
+    if (!isatty(STDOUT_FILENO)) {
+        printf("Error: the terminal backend needs a terminal to draw on\n");
+        return FALSE;
+    }
+
+    terminal_raw = FALSE;
+    if (isatty(STDIN_FILENO) && tcgetattr(STDIN_FILENO, &terminal_saved_settings) == 0) {
+        struct termios settings = terminal_saved_settings;
+        settings.c_iflag &= ~(IXON | ICRNL | INLCR | IGNCR);
+        settings.c_lflag &= ~(ICANON | ECHO | IEXTEN);
+        settings.c_cc[VMIN] = 0;
+        settings.c_cc[VTIME] = 0;
+        terminal_raw = (tcsetattr(STDIN_FILENO, TCSAFLUSH, &settings) == 0);
+    }
+
+    memset(terminal_key_release, 0, sizeof(terminal_key_release));
+    terminal_sequence_length = 0;
+    terminal_reset();
+    terminal_printf(STDOUT_FILENO, "\033[?1049h\033[?25l");
+    terminal_flush(STDOUT_FILENO);
+    return TRUE;
+}
+
+/******************************************************************************/
+
+/**
+ * Draws a frame on the terminal.
+ *
+ * @param frame the frame to present
+ */
+void
+video_terminal_present(const chip8frame *frame)
+{
+    terminal_render(frame, STDOUT_FILENO);
+}
+
+/******************************************************************************/
+
+/**
+ * Reads keys from the terminal, waiting at most 1 millisecond for them to
+ * arrive, and releases keys that have not been seen for a while.
+ */
+void
+video_terminal_process_events(void)
+{
+    char buffer[64];
+
+    if (terminal_raw) {
+        struct pollfd descriptor = { STDIN_FILENO, POLLIN, 0 };
+        if (poll(&descriptor, 1, 1) > 0) {
+            ssize_t length = read(STDIN_FILENO, buffer, sizeof(buffer));
+            if (length > 0) {
+                terminal_process_bytes(buffer, (int) length);
+            }
+        }
+    } else {
+        SDL_Delay(1);
+    }
+
+    Uint32 now = SDL_GetTicks();
+    terminal_process_escape(now);
+    for (int key = 0; key < TERMINAL_KEYS; key++) {
+        if (terminal_key_release[key] != 0 && (Sint32) (now - terminal_key_release[key]) >= 0) {
+            terminal_key_release[key] = 0;
+            input_push(INPUT_KEYUP, key);
+        }
+    }
+
+    // Quit events (for example, from an interrupt signal) still come from SDL
+    video_process_sdl_events(0);
+}
+
+/******************************************************************************/
+
+/**
+ * Restores the terminal to the way it was before the emulator started.
+ */
+void
+video_terminal_destroy(void)
+{
+    terminal_printf(STDOUT_FILENO, "\033[0m\033[?25h\033[?1049l");
+    terminal_flush(STDOUT_FILENO);
+    if (terminal_raw) {
+        tcsetattr(STDIN_FILENO, TCSAFLUSH, &terminal_saved_settings);
+        terminal_raw = FALSE;
+    }
+}
+
+/* E N D   O F   F I L E ******************************************************/
@@ -29,8 +29,21 @@ main() {
     CU_pSuite cpu_suite = CU_add_suite("CPU TESTS", 0, 0);
     CU_pSuite screen_suite = CU_add_suite("SCREEN TESTS", 0, 0);
     CU_pSuite keyboard_suite = CU_add_suite("KEYBOARD TESTS", 0, 0);
+    CU_pSuite expand_suite = CU_add_suite("EXPAND TESTS", 0, 0);
+    CU_pSuite frame_suite = CU_add_suite("FRAME TESTS", 0, 0);
+    CU_pSuite input_suite = CU_add_suite("INPUT TESTS", 0, 0);
+    CU_pSuite video_suite = CU_add_suite("VIDEO TESTS", 0, 0);
+    CU_pSuite record_suite = CU_add_suite("RECORD TESTS", 0, 0);
+    CU_pSuite shm_suite = CU_add_suite("SHM TESTS", 0, 0);
+    CU_pSuite audio_suite = CU_add_suite("AUDIO TESTS", 0, 0);
+    CU_pSuite latency_suite = CU_add_suite("LATENCY TESTS", 0, 0);
+    CU_pSuite realtime_suite = CU_add_suite("REALTIME TESTS", 0, 0);
+    CU_pSuite script_suite = CU_add_suite("SCRIPT TESTS", 0, 0);
 
-    if (cpu_suite == NULL || screen_suite == NULL || keyboard_suite == NULL) {
+    if (cpu_suite == NULL || screen_suite == NULL || keyboard_suite == NULL || expand_suite == NULL ||
+        frame_suite == NULL || input_suite == NULL || video_suite == NULL ||
+        record_suite == NULL || shm_suite == NULL || audio_suite == NULL ||
+        latency_suite == NULL || realtime_suite == NULL || script_suite == NULL) {
         CU_cleanup_registry();
         return CU_get_error();
     }
@@ -121,14 +134,28 @@ main() {
         CU_add_test(cpu_suite, "test_return_from_subroutine", test_return_from_subroutine) == NULL ||
         CU_add_test(cpu_suite, "test_return_from_subroutine_integration", test_return_from_subroutine_integration) == NULL ||
         CU_add_test(cpu_suite, "test_exit_interpreter", test_exit_interpreter) == NULL ||
+        CU_add_test(cpu_suite, "test_cpu_stopped_after_execute", test_cpu_stopped_after_execute) == NULL ||
         CU_add_test(cpu_suite, "test_index_load_long", test_index_load_long) == NULL ||
         CU_add_test(cpu_suite, "test_index_load_long", test_index_load_long_integration) == NULL ||
+        CU_add_test(cpu_suite, "test_draw_sprite_display_wait_quirks", test_draw_sprite_display_wait_quirks) == NULL ||
+        CU_add_test(cpu_suite, "test_draw_sprite_no_display_wait_quirks", test_draw_sprite_no_display_wait_quirks) == NULL ||
         CU_add_test(cpu_suite, "test_cpu_scroll_left", test_cpu_scroll_left) == NULL ||
         CU_add_test(cpu_suite, "test_cpu_scroll_right", test_cpu_scroll_right) == NULL ||
         CU_add_test(cpu_suite, "test_cpu_scroll_down", test_cpu_scroll_down) == NULL ||
         CU_add_test(cpu_suite, "test_cpu_screen_blank", test_cpu_screen_blank) == NULL ||
         CU_add_test(cpu_suite, "test_cpu_enable_extended_mode", test_cpu_enable_extended_mode) == NULL ||
-        CU_add_test(cpu_suite, "test_cpu_disable_extended_mode", test_cpu_disable_extended_mode) == NULL)
+        CU_add_test(cpu_suite, "test_cpu_disable_extended_mode", test_cpu_disable_extended_mode) == NULL ||
+        CU_add_test(cpu_suite, "test_cpu_process_input_drains_queue", test_cpu_process_input_drains_queue) == NULL ||
+        CU_add_test(cpu_suite, "test_cpu_run_ahead_restores_machine", test_cpu_run_ahead_restores_machine) == NULL ||
+        CU_add_test(cpu_suite, "test_cpu_run_frame", test_cpu_run_frame) == NULL ||
+        CU_add_test(cpu_suite, "test_cpu_run_ahead_publishes_future_frame", test_cpu_run_ahead_publishes_future_frame) == NULL ||
+        CU_add_test(cpu_suite, "test_cpu_frame_deadline", test_cpu_frame_deadline) == NULL ||
+        CU_add_test(cpu_suite, "test_memory_wraps_near_top_of_index", test_memory_wraps_near_top_of_index) == NULL ||
+        CU_add_test(cpu_suite, "test_draw_extended_sprite_wraps_near_top_of_index", test_draw_extended_sprite_wraps_near_top_of_index) == NULL ||
+        CU_add_test(cpu_suite, "test_memory_guard_pages_fault", test_memory_guard_pages_fault) == NULL ||
+        CU_add_test(cpu_suite, "test_memory_write_marks_dirty_pages", test_memory_write_marks_dirty_pages) == NULL ||
+        CU_add_test(cpu_suite, "test_cpu_run_ahead_rolls_back_memory", test_cpu_run_ahead_rolls_back_memory) == NULL ||
+        CU_add_test(cpu_suite, "test_cpu_run_ahead_repeats_random_numbers", test_cpu_run_ahead_repeats_random_numbers) == NULL)
     {
         CU_cleanup_registry();
         return CU_get_error();
@@ -156,7 +183,9 @@ main() {
         CU_add_test(screen_suite, "test_screen_scroll_up_bitplane_1_both_pixels_active", test_screen_scroll_up_bitplane_1_both_pixels_active) == NULL ||
         CU_add_test(screen_suite, "test_screen_scroll_up_bitplane_3_both_pixels_active", test_screen_scroll_up_bitplane_3_both_pixels_active) == NULL ||        CU_add_test(screen_suite, "test_screen_get_mode_scale_normal", test_screen_get_mode_scale_normal) == NULL ||
         CU_add_test(screen_suite, "test_screen_get_mode_scale_extended", test_screen_get_mode_scale_extended) == NULL ||
-        CU_add_test(screen_suite, "test_screen_is_mode_extended_correct", test_screen_is_mode_extended_correct) == NULL
+        CU_add_test(screen_suite, "test_screen_is_mode_extended_correct", test_screen_is_mode_extended_correct) == NULL ||
+        CU_add_test(screen_suite, "test_screen_hash_matches_full_hash", test_screen_hash_matches_full_hash) == NULL ||
+        CU_add_test(screen_suite, "test_screen_hash_changes", test_screen_hash_changes) == NULL
     )
     {
         CU_cleanup_registry();
@@ -166,7 +195,99 @@ main() {
     if (CU_add_test(keyboard_suite, "test_keyboard_checkforkeypress_returns_false_on_no_keypress", test_keyboard_checkforkeypress_returns_false_on_no_keypress) == NULL ||
         CU_add_test(keyboard_suite, "test_keyboard_process_keydown", test_keyboard_process_keydown) == NULL ||
         CU_add_test(keyboard_suite, "test_keyboard_process_keyup", test_keyboard_process_keyup) == NULL ||
-        CU_add_test(keyboard_suite, "test_keyboard_isemulatorkey", test_keyboard_isemulatorkey) == NULL)
+        CU_add_test(keyboard_suite, "test_keyboard_isemulatorkey", test_keyboard_isemulatorkey) == NULL ||
+        CU_add_test(keyboard_suite, "test_keyboard_state_mask", test_keyboard_state_mask) == NULL ||
+        CU_add_test(keyboard_suite, "test_keyboard_load_keymap", test_keyboard_load_keymap) == NULL ||
+        CU_add_test(keyboard_suite, "test_keyboard_load_keymap_errors", test_keyboard_load_keymap_errors) == NULL)
+    {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if (CU_add_test(expand_suite, "test_expand_scalar_colors", test_expand_scalar_colors) == NULL ||
+        CU_add_test(expand_suite, "test_expand_scalar_scaling", test_expand_scalar_scaling) == NULL ||
+        CU_add_test(expand_suite, "test_expand_kernels_match_scalar", test_expand_kernels_match_scalar) == NULL)
+    {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if (CU_add_test(frame_suite, "test_frame_acquire_empty", test_frame_acquire_empty) == NULL ||
+        CU_add_test(frame_suite, "test_frame_acquire_returns_newest", test_frame_acquire_returns_newest) == NULL ||
+        CU_add_test(frame_suite, "test_frame_acquire_only_once", test_frame_acquire_only_once) == NULL ||
+        CU_add_test(frame_suite, "test_frame_publish_hash", test_frame_publish_hash) == NULL ||
+        CU_add_test(frame_suite, "test_frame_publish_wakes_presenter", test_frame_publish_wakes_presenter) == NULL)
+    {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if (CU_add_test(input_suite, "test_input_push_pop_in_order", test_input_push_pop_in_order) == NULL ||
+        CU_add_test(input_suite, "test_input_push_full_queue", test_input_push_full_queue) == NULL ||
+        CU_add_test(input_suite, "test_input_push_wakes_cpu", test_input_push_wakes_cpu) == NULL)
+    {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if (CU_add_test(video_suite, "test_video_select_unknown_backend", test_video_select_unknown_backend) == NULL ||
+        CU_add_test(video_suite, "test_video_headless_backends_need_no_window", test_video_headless_backends_need_no_window) == NULL ||
+        CU_add_test(video_suite, "test_video_memory_present", test_video_memory_present) == NULL ||
+        CU_add_test(video_suite, "test_video_window_event_background", test_video_window_event_background) == NULL ||
+        CU_add_test(video_suite, "test_video_background_policy", test_video_background_policy) == NULL ||
+        CU_add_test(video_suite, "test_terminal_render_changed_cells", test_terminal_render_changed_cells) == NULL ||
+        CU_add_test(video_suite, "test_terminal_process_bytes", test_terminal_process_bytes) == NULL ||
+        CU_add_test(video_suite, "test_terminal_process_bytes_split_sequence", test_terminal_process_bytes_split_sequence) == NULL)
+    {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if (CU_add_test(record_suite, "test_record_rejects_unknown_format", test_record_rejects_unknown_format) == NULL ||
+        CU_add_test(record_suite, "test_record_y4m_elides_duplicate_frames", test_record_y4m_elides_duplicate_frames) == NULL ||
+        CU_add_test(record_suite, "test_record_gif", test_record_gif) == NULL ||
+        CU_add_test(record_suite, "test_record_write_png", test_record_write_png) == NULL)
+    {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if (CU_add_test(shm_suite, "test_shm_publish_and_read", test_shm_publish_and_read) == NULL ||
+        CU_add_test(shm_suite, "test_shm_read_skips_update_in_progress", test_shm_read_skips_update_in_progress) == NULL ||
+        CU_add_test(shm_suite, "test_shm_init_fails_while_segment_in_use", test_shm_init_fails_while_segment_in_use) == NULL ||
+        CU_add_test(shm_suite, "test_shm_init_replaces_stale_segment", test_shm_init_replaces_stale_segment) == NULL)
+    {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if (CU_add_test(audio_suite, "test_audio_generate_silent_when_gated", test_audio_generate_silent_when_gated) == NULL ||
+        CU_add_test(audio_suite, "test_audio_generate_plays_pattern", test_audio_generate_plays_pattern) == NULL ||
+        CU_add_test(audio_suite, "test_audio_load_pitch_changes_rate", test_audio_load_pitch_changes_rate) == NULL ||
+        CU_add_test(audio_suite, "test_audio_queue_applies_events_on_time", test_audio_queue_applies_events_on_time) == NULL ||
+        CU_add_test(audio_suite, "test_audio_wav_render", test_audio_wav_render) == NULL ||
+        CU_add_test(audio_suite, "test_audio_set_format", test_audio_set_format) == NULL)
+    {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if (CU_add_test(latency_suite, "test_latency_stages", test_latency_stages) == NULL ||
+        CU_add_test(latency_suite, "test_latency_waits_for_later_frame", test_latency_waits_for_later_frame) == NULL)
+    {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if (CU_add_test(realtime_suite, "test_realtime_jitter_stats", test_realtime_jitter_stats) == NULL ||
+        CU_add_test(realtime_suite, "test_realtime_init_rejects_bad_cores", test_realtime_init_rejects_bad_cores) == NULL)
+    {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if (CU_add_test(script_suite, "test_script_applies_commands_on_frames", test_script_applies_commands_on_frames) == NULL ||
+        CU_add_test(script_suite, "test_script_skips_bad_lines", test_script_skips_bad_lines) == NULL)
     {
         CU_cleanup_registry();
         return CU_get_error();
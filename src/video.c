@@ -0,0 +1,450 @@
+/**
+ * Copyright (C) 2025 Craig Thomas
+ * This project uses an MIT style license - see the LICENSE file for details.
+ *
+ * @file      video.c
+ * @brief     Video backends used to present frames
+ * @author    Craig Thomas
+ *
+ * The screen routines only ever draw into the packed bitplanes held in
+ * `display`. Getting those frames in front of a user is the job of a video
+ * backend. Each backend is described by a chip8video structure, and is
+ * selected by name with `video_select`. The following backends are available:
+ *
+ *   sdl      - presents frames in an SDL window (the default)
+ *   null     - throws frames away, for headless runs
+ *   memory   - converts frames into an in-memory framebuffer that callers can
+ *              inspect with `video_memory_pixels` and `video_memory_frame`
+ *   terminal - draws frames in the terminal, and reads keys from it (see
+ *              terminal.c)
+ *
+ * Only the sdl backend opens a window, so the other backends can be used
+ * without a display.
+ */
+
+/* I N C L U D E S ************************************************************/
+
+#include "globals.h"
+
+/* L O C A L S ****************************************************************/
+
+/*!
+ * The last frame presented to the memory backend
+ */
+static chip8frame video_memory_last_frame;
+
+/*!
+ * The converted pixels of the last frame presented to the memory backend
+ */
+static Uint32 video_memory_framebuffer[SCREEN_WIDTH * SCREEN_HEIGHT];
+
+/*!
+ * The hash of the frame currently held in the SDL texture
+ */
+static Uint64 video_sdl_texture_hash;
+
+/*!
+ * Whether the SDL texture holds a frame yet
+ */
+static int video_sdl_texture_valid;
+
+/*!
+ * Whether the SDL window is hidden, minimized or has lost focus. Only the main
+ * thread touches these.
+ */
+static int video_window_hidden;
+static int video_window_minimized;
+static int video_window_unfocused;
+
+/*!
+ * Set while any of the above is true, so other threads can see it
+ */
+static SDL_atomic_t video_background;
+
+/*!
+ * The names of the background policies, in the order of the BACKGROUND_
+ * defines
+ */
+static const char *video_background_policies[] = { "run", "pause", "skip", "slow", NULL };
+
+/*!
+ * The available video backends
+ */
+static chip8video video_backends[] =
+{
+    { "sdl",      TRUE,  video_sdl_init,      video_sdl_present,      video_sdl_process_events,      video_sdl_destroy      },
+    { "null",     FALSE, video_null_init,     video_null_present,     video_null_process_events,     video_null_destroy     },
+    { "memory",   FALSE, video_memory_init,   video_memory_present,   video_null_process_events,     video_null_destroy     },
+    { "terminal", FALSE, video_terminal_init, video_terminal_present, video_terminal_process_events, video_terminal_destroy },
+    { NULL,       FALSE, NULL,                NULL,                   NULL,                          NULL                   }
+};
+
+/* F U N C T I O N S **********************************************************/
+
+/**
+ * Waits up to timeout milliseconds for SDL events, then processes every event
+ * that is pending. Keyboard and quit events are passed along to the CPU
+ * thread through the input queue.
+ *
+ * @param timeout the maximum number of milliseconds to wait for an event, or
+ *        -1 to wait for as long as it takes
+ */
+void
+video_process_sdl_events(int timeout)
+{
+    if (!SDL_WaitEventTimeout(&event, timeout)) {
+        return;
+    }
+
+    do {
+        switch (event.type) {
+            case SDL_QUIT:
+                input_push(INPUT_QUIT, SDLK_UNKNOWN);
+                break;
+
+            case SDL_KEYDOWN:
+                input_push(INPUT_KEYDOWN, event.key.keysym.sym);
+                break;
+
+            case SDL_KEYUP:
+                input_push(INPUT_KEYUP, event.key.keysym.sym);
+                break;
+
+            case SDL_WINDOWEVENT:
+                video_window_event(&event.window);
+                break;
+
+            default:
+                break;
+        }
+    } while (SDL_PollEvent(&event));
+}
+
+/******************************************************************************/
+
+/**
+ * Creates the emulator window. The window is sized according to the scale
+ * factor, but the texture that backs it is always kept at the native
+ * resolution of the display. Returns TRUE if the window was created.
+ *
+ * @returns TRUE if the window was created, FALSE otherwise
+ */
+int
+video_sdl_init(void)
+{
+    int width = SCREEN_WIDTH * scale_factor;
+    int height = SCREEN_HEIGHT * scale_factor;
+
+    window = SDL_CreateWindow(
+        "YAC8 Emulator",
+        SDL_WINDOWPOS_UNDEFINED,
+        SDL_WINDOWPOS_UNDEFINED,
+        width,
+        height,
+        SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE
+    );
+
+    if (window == NULL) {
+        printf("Error: Unable to initialize window:\n%s\n", SDL_GetError());
+        return FALSE;
+    }
+
+    renderer = SDL_CreateRenderer(
+        window,
+        -1,
+        SDL_RENDERER_ACCELERATED
+    );
+
+    if (renderer == NULL) {
+        printf("Error: Unable to initialize renderer:\n%s\n", SDL_GetError());
+        return FALSE;
+    }
+
+    // Let the renderer do the upscaling, and keep the pixels sharp
+    SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "nearest");
+    SDL_RenderSetLogicalSize(renderer, SCREEN_WIDTH, SCREEN_HEIGHT);
+
+    texture = SDL_CreateTexture(
+        renderer,
+        SDL_PIXELFORMAT_ARGB8888,
+        SDL_TEXTUREACCESS_STREAMING,
+        SCREEN_WIDTH,
+        SCREEN_HEIGHT
+    );
+
+    if (texture == NULL) {
+        printf("Error: Unable to initialize texture:\n%s\n", SDL_GetError());
+        return FALSE;
+    }
+
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_NONE);
+    video_sdl_texture_valid = FALSE;
+    return TRUE;
+}
+
+/******************************************************************************/
+
+/**
+ * Presents a frame in the emulator window. The bitplanes are written directly
+ * into the texture, which the renderer then scales to fit the window. If the
+ * frame has the same hash as the one already in the texture, the upload is
+ * skipped.
+ *
+ * @param frame the frame to present
+ */
+void
+video_sdl_present(const chip8frame *frame)
+{
+    void *pixels;
+    int pitch;
+
+    if (!video_sdl_texture_valid || frame->hash != video_sdl_texture_hash) {
+        if (SDL_LockTexture(texture, NULL, &pixels, &pitch) != 0) {
+            return;
+        }
+        screen_convert(&frame->display, (Uint32 *)pixels, pitch);
+        SDL_UnlockTexture(texture);
+        video_sdl_texture_hash = frame->hash;
+        video_sdl_texture_valid = TRUE;
+    }
+
+    SDL_RenderClear(renderer);
+    SDL_RenderCopy(renderer, texture, NULL, NULL);
+    SDL_RenderPresent(renderer);
+}
+
+/******************************************************************************/
+
+/**
+ * Processes the events for the emulator window, sleeping until one arrives.
+ * Publishing a frame (or the CPU stopping) pushes an event too, so the main
+ * thread only wakes when there is something to do.
+ */
+void
+video_sdl_process_events(void)
+{
+    video_process_sdl_events(-1);
+}
+
+/******************************************************************************/
+
+/**
+ * Destroys the emulator window.
+ */
+void
+video_sdl_destroy(void)
+{
+    SDL_DestroyTexture(texture);
+    SDL_DestroyRenderer(renderer);
+    SDL_DestroyWindow(window);
+    texture = NULL;
+    renderer = NULL;
+    window = NULL;
+}
+
+/******************************************************************************/
+
+/**
+ * Initializes a backend that has nothing to set up.
+ *
+ * @returns always TRUE
+ */
+int
+video_null_init(void)
+{
+    return TRUE;
+}
+
+/******************************************************************************/
+
+/**
+ * Throws a frame away.
+ *
+ * @param frame the frame to present
+ */
+void
+video_null_present(const chip8frame *frame)
+{
+}
+
+/******************************************************************************/
+
+/**
+ * Processes events for a backend without a window. Only quit events (for
+ * example, from an interrupt signal) can arrive, so this sleeps until a frame
+ * is published (or the CPU stops), then picks up any quit event that arrived
+ * in the meantime.
+ */
+void
+video_null_process_events(void)
+{
+    frame_wait(SDL_MUTEX_MAXWAIT);
+    video_process_sdl_events(0);
+}
+
+/******************************************************************************/
+
+/**
+ * Destroys a backend that has nothing to tear down.
+ */
+void
+video_null_destroy(void)
+{
+}
+
+/******************************************************************************/
+
+/**
+ * Clears the in-memory framebuffer.
+ *
+ * @returns always TRUE
+ */
+int
+video_memory_init(void)
+{
+    memset(&video_memory_last_frame, 0, sizeof(video_memory_last_frame));
+    memset(video_memory_framebuffer, 0, sizeof(video_memory_framebuffer));
+    return TRUE;
+}
+
+/******************************************************************************/
+
+/**
+ * Keeps a copy of the frame, and converts it into the in-memory framebuffer.
+ *
+ * @param frame the frame to present
+ */
+void
+video_memory_present(const chip8frame *frame)
+{
+    memcpy(&video_memory_last_frame, frame, sizeof(chip8frame));
+    screen_convert(&frame->display, video_memory_framebuffer, SCREEN_WIDTH * sizeof(Uint32));
+}
+
+/******************************************************************************/
+
+/**
+ * Returns the ARGB8888 pixels of the last frame presented to the memory
+ * backend. The framebuffer is SCREEN_WIDTH x SCREEN_HEIGHT pixels.
+ *
+ * @returns the in-memory framebuffer
+ */
+const Uint32 *
+video_memory_pixels(void)
+{
+    return video_memory_framebuffer;
+}
+
+/******************************************************************************/
+
+/**
+ * Returns the last frame presented to the memory backend.
+ *
+ * @returns the last frame presented
+ */
+const chip8frame *
+video_memory_frame(void)
+{
+    return &video_memory_last_frame;
+}
+
+/******************************************************************************/
+
+/**
+ * Looks up a video backend by name. Returns NULL if there is no backend with
+ * that name.
+ *
+ * @param name the name of the backend
+ * @returns the backend, or NULL if it does not exist
+ */
+chip8video *
+video_select(const char *name)
+{
+    for (int x = 0; video_backends[x].name != NULL; x++) {
+        if (strcmp(video_backends[x].name, name) == 0) {
+            return &video_backends[x];
+        }
+    }
+    return NULL;
+}
+
+/******************************************************************************/
+
+/**
+ * Tracks whether the window is hidden, minimized or unfocused. SDL 2 has no
+ * event for a window that is covered by other windows, so on most desktops
+ * an occluded window only counts once it loses focus.
+ *
+ * @param window_event the window event to process
+ */
+void
+video_window_event(const SDL_WindowEvent *window_event)
+{
+    switch (window_event->event) {
+        case SDL_WINDOWEVENT_HIDDEN:
+            video_window_hidden = TRUE;
+            break;
+
+        case SDL_WINDOWEVENT_SHOWN:
+        case SDL_WINDOWEVENT_EXPOSED:
+            video_window_hidden = FALSE;
+            break;
+
+        case SDL_WINDOWEVENT_MINIMIZED:
+            video_window_minimized = TRUE;
+            break;
+
+        case SDL_WINDOWEVENT_RESTORED:
+        case SDL_WINDOWEVENT_MAXIMIZED:
+            video_window_minimized = FALSE;
+            break;
+
+        case SDL_WINDOWEVENT_FOCUS_LOST:
+            video_window_unfocused = TRUE;
+            break;
+
+        case SDL_WINDOWEVENT_FOCUS_GAINED:
+            video_window_unfocused = FALSE;
+            break;
+
+        default:
+            return;
+    }
+    SDL_AtomicSet(&video_background, video_window_hidden || video_window_minimized || video_window_unfocused);
+}
+
+/******************************************************************************/
+
+/**
+ * Returns TRUE if the window is hidden, minimized or unfocused. Safe to call
+ * from any thread.
+ *
+ * @returns TRUE if the window is in the background, FALSE otherwise
+ */
+int
+video_in_background(void)
+{
+    return SDL_AtomicGet(&video_background);
+}
+
+/******************************************************************************/
+
+/**
+ * Looks up a background policy by name (`run`, `pause`, `skip` or `slow`).
+ * Returns -1 if there is no policy with that name.
+ *
+ * @param name the name of the policy
+ * @returns the policy (one of the BACKGROUND_ defines), or -1
+ */
+int
+video_background_policy(const char *name)
+{
+    for (int x = 0; video_background_policies[x] != NULL; x++) {
+        if (strcmp(video_background_policies[x], name) == 0) {
+            return x;
+        }
+    }
+    return -1;
+}
+
+/* E N D   O F   F I L E ******************************************************/
@@ -0,0 +1,189 @@
+/**
+ * Copyright (C) 2025 Craig Thomas
+ * This project uses an MIT style license - see the LICENSE file for details.
+ *
+ * @file      video_test.c
+ * @brief     Tests for the video backends
+ * @author    Craig Thomas
+ */
+
+/* I N C L U D E S ************************************************************/
+
+#include <CUnit/CUnit.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "globals.h"
+
+/* F U N C T I O N S **********************************************************/
+
+void
+test_video_select_unknown_backend(void)
+{
+    CU_ASSERT_PTR_NULL(video_select("unknown"));
+    CU_ASSERT_PTR_NOT_NULL(video_select("sdl"));
+}
+
+void
+test_video_headless_backends_need_no_window(void)
+{
+    CU_ASSERT_TRUE(video_select("sdl")->needs_window);
+    CU_ASSERT_FALSE(video_select("null")->needs_window);
+    CU_ASSERT_FALSE(video_select("memory")->needs_window);
+}
+
+void
+test_video_memory_present(void)
+{
+    chip8frame frame;
+    chip8video *memory_video = video_select("memory");
+
+    CU_TEST_FATAL(screen_init());
+    CU_TEST_FATAL(memory_video->init());
+    memset(&frame, 0, sizeof(frame));
+    frame.display.plane[0][0][0] = 0x80;
+    frame.display.plane[1][0][0] = 0x40;
+    frame.display.plane[0][1][0] = 0x20;
+    frame.display.plane[1][1][0] = 0x20;
+    frame.number = 7;
+    memory_video->present(&frame);
+
+    const Uint32 *pixels = video_memory_pixels();
+    CU_ASSERT_EQUAL(COLOR_1, pixels[0]);
+    CU_ASSERT_EQUAL(COLOR_2, pixels[1]);
+    CU_ASSERT_EQUAL(COLOR_0, pixels[2]);
+    CU_ASSERT_EQUAL(COLOR_3, pixels[SCREEN_WIDTH + 2]);
+    CU_ASSERT_EQUAL(7, video_memory_frame()->number);
+    memory_video->destroy();
+    screen_destroy();
+}
+
+void
+test_video_window_event_background(void)
+{
+    SDL_WindowEvent window_event;
+
+    memset(&window_event, 0, sizeof(window_event));
+    CU_ASSERT_FALSE(video_in_background());
+
+    // Minimizing also loses focus, so both have to come back
+    window_event.event = SDL_WINDOWEVENT_MINIMIZED;
+    video_window_event(&window_event);
+    CU_ASSERT_TRUE(video_in_background());
+    window_event.event = SDL_WINDOWEVENT_FOCUS_LOST;
+    video_window_event(&window_event);
+    window_event.event = SDL_WINDOWEVENT_RESTORED;
+    video_window_event(&window_event);
+    CU_ASSERT_TRUE(video_in_background());
+    window_event.event = SDL_WINDOWEVENT_FOCUS_GAINED;
+    video_window_event(&window_event);
+    CU_ASSERT_FALSE(video_in_background());
+
+    window_event.event = SDL_WINDOWEVENT_HIDDEN;
+    video_window_event(&window_event);
+    CU_ASSERT_TRUE(video_in_background());
+    window_event.event = SDL_WINDOWEVENT_MOVED;
+    video_window_event(&window_event);
+    CU_ASSERT_TRUE(video_in_background());
+
+    // The policy only takes effect while in the background
+    background_policy = BACKGROUND_SKIP;
+    CU_ASSERT_EQUAL(BACKGROUND_SKIP, cpu_background_mode());
+    window_event.event = SDL_WINDOWEVENT_SHOWN;
+    video_window_event(&window_event);
+    CU_ASSERT_FALSE(video_in_background());
+    CU_ASSERT_EQUAL(BACKGROUND_RUN, cpu_background_mode());
+    background_policy = BACKGROUND_RUN;
+}
+
+void
+test_video_background_policy(void)
+{
+    CU_ASSERT_EQUAL(BACKGROUND_RUN, video_background_policy("run"));
+    CU_ASSERT_EQUAL(BACKGROUND_PAUSE, video_background_policy("pause"));
+    CU_ASSERT_EQUAL(BACKGROUND_SKIP, video_background_policy("skip"));
+    CU_ASSERT_EQUAL(BACKGROUND_SLOW, video_background_policy("slow"));
+    CU_ASSERT_EQUAL(-1, video_background_policy("sleep"));
+}
+
+void
+test_terminal_render_changed_cells(void)
+{
+    chip8frame frame;
+    char buffer[16384];
+    int fds[2];
+
+    CU_TEST_FATAL(screen_init());
+    CU_TEST_FATAL(pipe(fds) == 0);
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    memset(&frame, 0, sizeof(frame));
+    frame.screen_mode = SCREEN_MODE_EXTENDED;
+    terminal_reset();
+
+    terminal_render(&frame, fds[1]);
+    CU_ASSERT_TRUE(read(fds[0], buffer, sizeof(buffer)) > 128 * 32 * 3);
+
+    terminal_render(&frame, fds[1]);
+    CU_ASSERT_EQUAL(-1, read(fds[0], buffer, sizeof(buffer)));
+
+    frame.display.plane[0][1][0] = 0x80;
+    terminal_render(&frame, fds[1]);
+    ssize_t length = read(fds[0], buffer, sizeof(buffer));
+    CU_ASSERT_TRUE(length > 0 && length < 64);
+    buffer[length > 0 ? length : 0] = 0;
+    CU_ASSERT_PTR_NOT_NULL(strstr(buffer, "\033[1;1H"));
+
+    close(fds[0]);
+    close(fds[1]);
+    screen_destroy();
+}
+
+void
+test_terminal_process_bytes(void)
+{
+    chip8input input;
+
+    input_init();
+    terminal_process_bytes("a\033[24~\033[A\033", 10);
+
+    CU_ASSERT_TRUE(input_pop(&input));
+    CU_ASSERT_EQUAL(INPUT_KEYDOWN, input.type);
+    CU_ASSERT_EQUAL(SDLK_a, input.key);
+    CU_ASSERT_TRUE(input_pop(&input));
+    CU_ASSERT_EQUAL(INPUT_KEYDOWN, input.type);
+    CU_ASSERT_EQUAL(SCREENSHOT_KEY, input.key);
+    CU_ASSERT_TRUE(input_pop(&input));
+    CU_ASSERT_EQUAL(INPUT_KEYUP, input.type);
+    CU_ASSERT_FALSE(input_pop(&input));
+
+    // The trailing escape only becomes the escape key once nothing follows it
+    terminal_process_escape(SDL_GetTicks());
+    CU_ASSERT_FALSE(input_pop(&input));
+    terminal_process_escape(SDL_GetTicks() + 1000);
+    CU_ASSERT_TRUE(input_pop(&input));
+    CU_ASSERT_EQUAL(INPUT_KEYDOWN, input.type);
+    CU_ASSERT_EQUAL(SDLK_ESCAPE, input.key);
+    CU_ASSERT_FALSE(input_pop(&input));
+    input_init();
+}
+
+void
+test_terminal_process_bytes_split_sequence(void)
+{
+    chip8input input;
+
+    input_init();
+    terminal_process_bytes("\033", 1);
+    terminal_process_bytes("[A\033[2", 5);
+    terminal_process_bytes("4~", 2);
+    terminal_process_escape(SDL_GetTicks() + 1000);
+
+    CU_ASSERT_TRUE(input_pop(&input));
+    CU_ASSERT_EQUAL(INPUT_KEYDOWN, input.type);
+    CU_ASSERT_EQUAL(SCREENSHOT_KEY, input.key);
+    CU_ASSERT_TRUE(input_pop(&input));
+    CU_ASSERT_EQUAL(INPUT_KEYUP, input.type);
+    CU_ASSERT_FALSE(input_pop(&input));
+    input_init();
+}
+
+/* E N D   O F   F I L E ******************************************************/
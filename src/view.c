@@ -0,0 +1,147 @@
+/**
+ * Copyright (C) 2025 Craig Thomas
+ * This project uses an MIT style license - see the LICENSE file for details.
+ *
+ * @file      view.c
+ * @brief     A viewer for emulators that export their screen
+ * @author    Craig Thomas
+ *
+ * Shows the screens of several running emulators (started with --shm) tiled
+ * in a single window. Each segment is read with shm_read, so the viewer never
+ * holds up the emulators it is watching. Emulators that are not running yet
+ * are picked up once they start.
+ */
+
+/* I N C L U D E S ************************************************************/
+
+#include <math.h>
+#include <stdlib.h>
+#include "globals.h"
+
+/* D E F I N E S **************************************************************/
+
+#define VIEW_SCALE        2      /**< Initial scale of each tile              */
+#define VIEW_DELAY        16     /**< Milliseconds between refreshes          */
+#define VIEW_RETRY_FRAMES 60     /**< Refreshes between attach attempts       */
+
+/* F U N C T I O N S **********************************************************/
+
+/**
+ * Prints out the usage message.
+ */
+void
+view_print_help(void)
+{
+    printf("usage: yac8e-view NAME [NAME ...]\n\n");
+    printf("Shows the screens of emulators started with --shm NAME, tiled in\n");
+    printf("a single window.\n");
+}
+
+/* M A I N ********************************************************************/
+
+int
+main(int argc, char **argv)
+{
+    int count = argc - 1;
+    if (count < 1) {
+        view_print_help();
+        return 1;
+    }
+
+    int columns = (int) ceil(sqrt(count));
+    int rows = (count + columns - 1) / columns;
+    int width = columns * SCREEN_WIDTH;
+    int height = rows * SCREEN_HEIGHT;
+
+    if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+        printf("Fatal: Unable to initialize SDL\n%s\n", SDL_GetError());
+        return 1;
+    }
+
+    SDL_Window *view_window = SDL_CreateWindow(
+        "YAC8 Viewer",
+        SDL_WINDOWPOS_UNDEFINED,
+        SDL_WINDOWPOS_UNDEFINED,
+        width * VIEW_SCALE,
+        height * VIEW_SCALE,
+        SDL_WINDOW_RESIZABLE
+    );
+    SDL_Renderer *view_renderer = view_window ? SDL_CreateRenderer(view_window, -1, 0) : NULL;
+    SDL_Texture *view_texture = view_renderer ? SDL_CreateTexture(
+        view_renderer,
+        SDL_PIXELFORMAT_ARGB8888,
+        SDL_TEXTUREACCESS_STREAMING,
+        width,
+        height
+    ) : NULL;
+
+    if (view_texture == NULL) {
+        printf("Fatal: Unable to create window\n%s\n", SDL_GetError());
+        SDL_Quit();
+        return 1;
+    }
+
+    SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "nearest");
+    SDL_RenderSetLogicalSize(view_renderer, width, height);
+    expand_init();
+
+    const chip8shared **segments = calloc(count, sizeof(chip8shared *));
+    Uint32 *last_frames = calloc(count, sizeof(Uint32));
+    Uint32 *canvas = calloc(width * height, sizeof(Uint32));
+    chip8shared copy;
+    int running = TRUE;
+
+    for (int refresh = 0; running; refresh++) {
+        SDL_Event view_event;
+        while (SDL_PollEvent(&view_event)) {
+            if (view_event.type == SDL_QUIT ||
+                    (view_event.type == SDL_KEYDOWN && view_event.key.keysym.sym == QUIT_KEY)) {
+                running = FALSE;
+            }
+        }
+
+        int changed = FALSE;
+        for (int n = 0; n < count; n++) {
+            if (segments[n] == NULL) {
+                if (refresh % VIEW_RETRY_FRAMES == 0) {
+                    segments[n] = shm_attach(argv[n + 1]);
+                }
+                continue;
+            }
+
+            if (!shm_read(segments[n], &copy) || copy.frame == last_frames[n]) {
+                continue;
+            }
+
+            int x = (n % columns) * SCREEN_WIDTH;
+            int y = (n / columns) * SCREEN_HEIGHT;
+            expand_bitplanes(&copy.display, &canvas[y * width + x], width * sizeof(Uint32), copy.palette, 1, 1);
+            last_frames[n] = copy.frame;
+            changed = TRUE;
+        }
+
+        if (changed) {
+            SDL_UpdateTexture(view_texture, NULL, canvas, width * sizeof(Uint32));
+        }
+        SDL_RenderClear(view_renderer);
+        SDL_RenderCopy(view_renderer, view_texture, NULL, NULL);
+        SDL_RenderPresent(view_renderer);
+        SDL_Delay(VIEW_DELAY);
+    }
+
+    for (int n = 0; n < count; n++) {
+        if (segments[n] != NULL) {
+            shm_detach(segments[n]);
+        }
+    }
+    free(segments);
+    free(last_frames);
+    free(canvas);
+    SDL_DestroyTexture(view_texture);
+    SDL_DestroyRenderer(view_renderer);
+    SDL_DestroyWindow(view_window);
+    SDL_Quit();
+    return 0;
+}
+
+/* E N D   O F   F I L E ******************************************************/
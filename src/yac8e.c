@@ -53,7 +53,7 @@ loadrom(char *romfilename, int offset)
 void 
 print_help(void) 
 {
-    printf("usage: yac8e [-h] [-s N] [-j] [-i] [-l] [-c] [-S] [-t N] ROM\n\n");
+    printf("usage: yac8e [-h] [-s N] [-j] [-i] [-l] [-c] [-S] [-w] [-t N] [-v NAME] [-H] [-r FILE] [-m NAME] [-A FILE] [-u] [-R N] [-b N] [-L] [-k FILE] [-p N] [-I FILE] [-T] [-a N] [-x CORES] [-J] [-B POLICY] ROM\n\n");
     printf("Starts a simple Chip 8 emulator. See README.md for more ");
     printf("information, and\nLICENSE for terms of use.\n\n");
     printf("positional arguments:\n");
@@ -65,8 +65,26 @@ print_help(void)
     printf("  -i, --index_quirks enables index quirks\n");
     printf("  -S, --shift_quirks enables shift quirks\n");
     printf("  -l, --logic_quirks enables logic quirks\n");
-    printf("  -c, --clip_quirks  enables clip quirks");
+    printf("  -c, --clip_quirks  enables clip quirks\n");
+    printf("  -w, --display_wait_quirks  drawing waits for the next frame\n");
     printf("  -t, --ticks N      how many instructions per second are allowed\n");
+    printf("  -v, --video NAME   the video backend to use (sdl, null, memory, terminal)\n");
+    printf("  -H, --hashes       prints a hash of the screen for every frame\n");
+    printf("  -r, --record FILE  records video to FILE (.y4m or .gif)\n");
+    printf("  -m, --shm NAME     exports the screen to shared memory segment NAME\n");
+    printf("  -A, --wav FILE     renders audio to FILE instead of playing it\n");
+    printf("  -u, --unthrottled  runs frames as fast as possible\n");
+    printf("  -R, --audio_rate N   the audio sample rate in Hz (default 48000)\n");
+    printf("  -b, --audio_buffer N the audio buffer size in samples (default 512)\n");
+    printf("  -L, --audio_stats    prints audio latency and underruns on exit\n");
+    printf("  -k, --keymap FILE  loads the keyboard mapping from FILE\n");
+    printf("  -p, --poll N       also checks for input every N instructions\n");
+    printf("  -I, --input FILE   presses keys as scripted in FILE (- for stdin)\n");
+    printf("  -T, --latency      measures input latency, printed on exit or with F11\n");
+    printf("  -a, --run_ahead N  shows frames N frames ahead to hide input lag\n");
+    printf("  -x, --realtime CORES  pins to CORES (CPU or CPU,AUDIO) with realtime priority\n");
+    printf("  -J, --jitter       prints frame time jitter on exit\n");
+    printf("  -B, --background POLICY  when hidden or unfocused: run, pause, skip or slow\n");
 }
 
 /******************************************************************************/
@@ -85,12 +103,30 @@ parse_options(int argc, char **argv)
     shift_quirks = FALSE;
     index_quirks = FALSE;
     clip_quirks = FALSE;
+    display_wait_quirks = FALSE;
     scale_factor = SCALE_FACTOR;
     max_ticks = DEFAULT_MAX_TICKS;
     op_delay = 0;
+    print_hashes = FALSE;
+    record_filename = NULL;
+    shm_name = NULL;
+    wav_filename = NULL;
+    unthrottled = FALSE;
+    audio_stats = FALSE;
+    keymap_filename = NULL;
+    poll_interval = 0;
+    script_filename = NULL;
+    latency_stats = FALSE;
+    run_ahead = 0;
+    realtime_cores = NULL;
+    jitter_stats = FALSE;
+    background_policy = BACKGROUND_RUN;
+    video = video_select("sdl");
+    int sample_rate = AUDIO_PLAYBACK_RATE;
+    int buffer_samples = AUDIO_SAMPLES;
 
     int option_index = 0;
-    const char *short_options = ":hjiSslct:";
+    const char *short_options = ":hjiSslcwt:v:Hr:m:A:uR:b:Lk:p:I:Ta:x:JB:";
     static struct option long_options[] =
     {
         {"help",         no_argument,       NULL, 'h'},
@@ -100,7 +136,25 @@ parse_options(int argc, char **argv)
         {"scale",        required_argument, NULL, 's'},
         {"logic_quirks", no_argument,       NULL, 'l'},
         {"clip_quirks",  no_argument,       NULL, 'c'},
+        {"display_wait_quirks", no_argument, NULL, 'w'},
         {"ticks",        required_argument, NULL, 't'},
+        {"video",        required_argument, NULL, 'v'},
+        {"hashes",       no_argument,       NULL, 'H'},
+        {"record",       required_argument, NULL, 'r'},
+        {"shm",          required_argument, NULL, 'm'},
+        {"wav",          required_argument, NULL, 'A'},
+        {"unthrottled",  no_argument,       NULL, 'u'},
+        {"audio_rate",   required_argument, NULL, 'R'},
+        {"audio_buffer", required_argument, NULL, 'b'},
+        {"audio_stats",  no_argument,       NULL, 'L'},
+        {"keymap",       required_argument, NULL, 'k'},
+        {"poll",         required_argument, NULL, 'p'},
+        {"input",        required_argument, NULL, 'I'},
+        {"latency",      no_argument,       NULL, 'T'},
+        {"run_ahead",    required_argument, NULL, 'a'},
+        {"realtime",     required_argument, NULL, 'x'},
+        {"jitter",       no_argument,       NULL, 'J'},
+        {"background",   required_argument, NULL, 'B'},
         {NULL,           0,                 NULL,   0}
     };
 
@@ -135,6 +189,95 @@ parse_options(int argc, char **argv)
                 }
                 break;
 
+            case 'v':
+                video = video_select(optarg);
+                if (video == NULL) {
+                    printf("Invalid --video option");
+                    print_help();
+                    exit(1);
+                }
+                break;
+
+            case 'H':
+                print_hashes = TRUE;
+                break;
+
+            case 'r':
+                record_filename = optarg;
+                break;
+
+            case 'm':
+                shm_name = optarg;
+                break;
+
+            case 'A':
+                wav_filename = optarg;
+                break;
+
+            case 'u':
+                unthrottled = TRUE;
+                break;
+
+            case 'R':
+                sample_rate = atoi(optarg);
+                break;
+
+            case 'b':
+                buffer_samples = atoi(optarg);
+                break;
+
+            case 'L':
+                audio_stats = TRUE;
+                break;
+
+            case 'k':
+                keymap_filename = optarg;
+                break;
+
+            case 'p':
+                poll_interval = atoi(optarg);
+                if (poll_interval < 1) {
+                    printf("Invalid --poll option");
+                    print_help();
+                    exit(1);
+                }
+                break;
+
+            case 'I':
+                script_filename = optarg;
+                break;
+
+            case 'T':
+                latency_stats = TRUE;
+                break;
+
+            case 'a':
+                run_ahead = atoi(optarg);
+                if (run_ahead < 1 || run_ahead > CPU_MAX_RUN_AHEAD) {
+                    printf("Invalid --run_ahead option (1 - %d)", CPU_MAX_RUN_AHEAD);
+                    print_help();
+                    exit(1);
+                }
+                break;
+
+            case 'x':
+                realtime_cores = optarg;
+                jitter_stats = TRUE;
+                break;
+
+            case 'J':
+                jitter_stats = TRUE;
+                break;
+
+            case 'B':
+                background_policy = video_background_policy(optarg);
+                if (background_policy < 0) {
+                    printf("Invalid --background option");
+                    print_help();
+                    exit(1);
+                }
+                break;
+
             case 'j':
                 jump_quirks = TRUE;
                 break;
@@ -155,6 +298,10 @@ parse_options(int argc, char **argv)
                 clip_quirks = TRUE;
                 break;
 
+            case 'w':
+                display_wait_quirks = TRUE;
+                break;
+
             default:
                 break;
         }
@@ -175,11 +322,50 @@ parse_options(int argc, char **argv)
         exit(1);
     }
 
+    if (keymap_filename != NULL && !keyboard_load_keymap(keymap_filename)) {
+        exit(1);
+    }
+
+    if (!audio_set_format(sample_rate, buffer_samples)) {
+        printf("Invalid --audio_rate or --audio_buffer option (rates %d - %d, ", AUDIO_MIN_RATE, AUDIO_MAX_RATE);
+        printf("buffers a power of two from %d - %d)\n", AUDIO_MIN_SAMPLES, AUDIO_MAX_SAMPLES);
+        print_help();
+        exit(1);
+    }
+
     max_ticks = max_ticks / 60;
 
     return filename;
 }
 
+/**
+ * The main thread loop. The main thread owns the video backend, so it is
+ * responsible for handling window and keyboard events, and presenting the
+ * frames that the CPU thread publishes. It runs until the CPU is stopped.
+ * Since the CPU runs on its own thread, a slow present never holds up
+ * emulation.
+ */
+void
+host_execute(void)
+{
+    while (!cpu_stopped()) {
+        video->process_events();
+
+        // Frames are left where they are while nothing is presented in the
+        // background, so the newest one is still waiting to be shown as soon
+        // as the window comes back
+        int mode = cpu_background_mode();
+        if (mode == BACKGROUND_SKIP || mode == BACKGROUND_PAUSE) {
+            continue;
+        }
+        chip8frame *frame = frame_acquire();
+        if (frame != NULL) {
+            video->present(frame);
+            latency_present(frame);
+        }
+    }
+}
+
 /* M A I N *******************************************************************/
 
 /**
@@ -198,13 +384,27 @@ main(int argc, char **argv)
 
     filename = parse_options(argc, argv);
 
-    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) < 0) {
+    Uint32 subsystems = SDL_INIT_EVENTS;
+    if (wav_filename == NULL) {
+        subsystems |= SDL_INIT_AUDIO;
+    }
+    if (video->needs_window) {
+        subsystems |= SDL_INIT_VIDEO;
+    }
+
+    if (SDL_Init(subsystems) < 0) {
         printf("Fatal: Unable to initialize SDL\n%s\n", SDL_GetError());
         exit(1);
     }
 
-    if (Mix_OpenAudio(AUDIO_PLAYBACK_RATE, AUDIO_U8, 1, 512) < 0) {
-        printf("Fatal: Unable to initialize SDL_mixer\n%s\n", SDL_GetError());
+    if (realtime_cores != NULL && !realtime_init(realtime_cores)) {
+        SDL_Quit();
+        exit(1);
+    }
+
+    if (wav_filename != NULL ? !audio_wav_init(wav_filename) : !audio_init()) {
+        printf("Fatal: Unable to initialize audio\n");
+        SDL_Quit();
         exit(1);
     }
 
@@ -213,6 +413,9 @@ main(int argc, char **argv)
         SDL_Quit ();
         exit (1);
     }
+    if (realtime_cores != NULL) {
+        realtime_prefault(memory, MEM_SIZE);
+    }
 
     if (!loadrom("FONTS.chip8", 0)) {
         printf("Fatal: Could not load FONTS.chip8\n");
@@ -228,7 +431,9 @@ main(int argc, char **argv)
         exit(1);
     }
 
-    if (!screen_init()) {
+    expand_init();
+
+    if (!screen_init() || !video->init()) {
         printf("Fatal: Emulator shutdown due to errors\n");
         memory_destroy();
         SDL_Quit();
@@ -242,10 +447,65 @@ main(int argc, char **argv)
         exit(1);
     }
 
-    cpu_execute();
+    if (!record_init(record_filename)) {
+        printf("Fatal: Emulator shutdown due to errors\n");
+        memory_destroy();
+        SDL_Quit();
+        exit(1);
+    }
+
+    if (shm_name != NULL && !shm_init(shm_name)) {
+        printf("Fatal: Emulator shutdown due to errors\n");
+        record_destroy();
+        memory_destroy();
+        SDL_Quit();
+        exit(1);
+    }
+
+    if (script_filename != NULL && !script_init(script_filename)) {
+        printf("Fatal: Emulator shutdown due to errors\n");
+        shm_destroy();
+        record_destroy();
+        memory_destroy();
+        SDL_Quit();
+        exit(1);
+    }
+
+    frame_init();
+    input_init();
+    latency_reset();
+    cpu_thread_handle = SDL_CreateThread(cpu_thread, "cpu", NULL);
+    if (cpu_thread_handle == NULL) {
+        printf("Fatal: Unable to start CPU thread\n%s\n", SDL_GetError());
+        memory_destroy();
+        SDL_Quit();
+        exit(1);
+    }
+
+    host_execute();
+    SDL_WaitThread(cpu_thread_handle, NULL);
+    cpu_timerdestroy();
+    script_destroy();
+    audio_wav_destroy();
+    record_destroy();
+    shm_destroy();
 
     memory_destroy();
+    video->destroy();
     screen_destroy();
+    audio_destroy();
+    if (audio_stats) {
+        audio_print_stats();
+    }
+    if (latency_stats) {
+        latency_print_stats();
+    }
+    if (run_ahead) {
+        cpu_print_run_ahead_stats();
+    }
+    if (jitter_stats) {
+        realtime_print_stats();
+    }
     SDL_Quit();
     return 0;
 }